@@ -0,0 +1,222 @@
+#include "App_Adpcm.h"
+
+static const int16_t stepTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+    34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143,
+    157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658,
+    724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
+    3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t indexTable[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+// 编码一个采样，更新预测值和步长索引 (与解码端完全一致，保证两边同步)
+static inline uint8_t encodeSample(int32_t sample, int32_t &predictor, int &index) {
+    int32_t step = stepTable[index];
+    int32_t diff = sample - predictor;
+    uint8_t nibble = 0;
+    if (diff < 0) {
+        nibble = 8;
+        diff = -diff;
+    }
+
+    int32_t delta = step >> 3;
+    if (diff >= step) { nibble |= 4; diff -= step; delta += step; }
+    step >>= 1;
+    if (diff >= step) { nibble |= 2; diff -= step; delta += step; }
+    step >>= 1;
+    if (diff >= step) { nibble |= 1; delta += step; }
+
+    predictor += (nibble & 8) ? -delta : delta;
+    if (predictor > 32767) predictor = 32767;
+    else if (predictor < -32768) predictor = -32768;
+
+    index += indexTable[nibble];
+    if (index < 0) index = 0;
+    else if (index > 88) index = 88;
+    return nibble;
+}
+
+static inline int16_t decodeSample(uint8_t nibble, int32_t &predictor, int &index) {
+    int32_t step = stepTable[index];
+    int32_t delta = step >> 3;
+    if (nibble & 4) delta += step;
+    if (nibble & 2) delta += step >> 1;
+    if (nibble & 1) delta += step >> 2;
+
+    predictor += (nibble & 8) ? -delta : delta;
+    if (predictor > 32767) predictor = 32767;
+    else if (predictor < -32768) predictor = -32768;
+
+    index += indexTable[nibble];
+    if (index < 0) index = 0;
+    else if (index > 88) index = 88;
+    return (int16_t)predictor;
+}
+
+void AdpcmEncoder::reset() {
+    _count = 0;
+    _total = 0;
+    _predictor = 0;
+    _index = 0;
+}
+
+size_t AdpcmEncoder::maxOutput(size_t samples) {
+    return ((samples / ADPCM_BLOCK_SAMPLES) + 1) * ADPCM_BLOCK_BYTES;
+}
+
+void AdpcmEncoder::encodeBlock(const int16_t *pcm, uint8_t *out) {
+    // 块头：第一个采样原样保存，作为本块的初始预测值
+    _predictor = pcm[0];
+    out[0] = (uint8_t)(pcm[0] & 0xFF);
+    out[1] = (uint8_t)((pcm[0] >> 8) & 0xFF);
+    out[2] = (uint8_t)_index;
+    out[3] = 0;
+
+    uint8_t *p = out + 4;
+    for (int i = 1; i < ADPCM_BLOCK_SAMPLES; i += 2) {
+        uint8_t lo = encodeSample(pcm[i], _predictor, _index);
+        uint8_t hi = encodeSample(pcm[i + 1], _predictor, _index);
+        *p++ = lo | (hi << 4);
+    }
+}
+
+size_t AdpcmEncoder::encode(const int16_t *pcm, size_t samples, uint8_t *out) {
+    size_t produced = 0;
+    _total += samples;
+
+    // 先补齐上次剩下的不完整块
+    if (_count > 0) {
+        size_t need = ADPCM_BLOCK_SAMPLES - _count;
+        size_t n = (samples < need) ? samples : need;
+        memcpy(_pending + _count, pcm, n * sizeof(int16_t));
+        _count += n;
+        pcm += n;
+        samples -= n;
+        if (_count < ADPCM_BLOCK_SAMPLES) return 0;
+        encodeBlock(_pending, out);
+        produced += ADPCM_BLOCK_BYTES;
+        _count = 0;
+    }
+
+    // 整块直接从输入编码，不经过中间缓冲
+    while (samples >= ADPCM_BLOCK_SAMPLES) {
+        encodeBlock(pcm, out + produced);
+        produced += ADPCM_BLOCK_BYTES;
+        pcm += ADPCM_BLOCK_SAMPLES;
+        samples -= ADPCM_BLOCK_SAMPLES;
+    }
+
+    memcpy(_pending, pcm, samples * sizeof(int16_t));
+    _count = samples;
+    return produced;
+}
+
+size_t AdpcmEncoder::flush(uint8_t *out) {
+    if (_count == 0) return 0;
+    int16_t last = _pending[_count - 1];
+    for (size_t i = _count; i < ADPCM_BLOCK_SAMPLES; i++) _pending[i] = last;
+    encodeBlock(_pending, out);
+    _count = 0;
+    return ADPCM_BLOCK_BYTES;
+}
+
+static void putLE16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void putLE32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)((v >> 8) & 0xFF);
+    p[2] = (uint8_t)((v >> 16) & 0xFF);
+    p[3] = (uint8_t)((v >> 24) & 0xFF);
+}
+
+void AdpcmEncoder::writeWavHeader(uint8_t *header, uint32_t sampleRate, uint32_t totalSamples) {
+    uint32_t dataLen = ADPCM_UNKNOWN_LENGTH;
+    uint32_t riffLen = ADPCM_UNKNOWN_LENGTH;
+    if (totalSamples != ADPCM_UNKNOWN_LENGTH) {
+        uint32_t blocks = (totalSamples + ADPCM_BLOCK_SAMPLES - 1) / ADPCM_BLOCK_SAMPLES;
+        dataLen = blocks * ADPCM_BLOCK_BYTES;
+        riffLen = dataLen + ADPCM_WAV_HEADER_SIZE - 8;
+    }
+
+    memcpy(header, "RIFF", 4);
+    putLE32(header + 4, riffLen);
+    memcpy(header + 8, "WAVE", 4);
+
+    memcpy(header + 12, "fmt ", 4);
+    putLE32(header + 16, 20);
+    putLE16(header + 20, 0x0011);                   // IMA ADPCM
+    putLE16(header + 22, 1);                        // 单声道
+    putLE32(header + 24, sampleRate);
+    putLE32(header + 28, sampleRate * ADPCM_BLOCK_BYTES / ADPCM_BLOCK_SAMPLES);
+    putLE16(header + 32, ADPCM_BLOCK_BYTES);        // blockAlign
+    putLE16(header + 34, 4);                        // bits per sample
+    putLE16(header + 36, 2);                        // cbSize
+    putLE16(header + 38, ADPCM_BLOCK_SAMPLES);      // samples per block
+
+    memcpy(header + 40, "fact", 4);
+    putLE32(header + 44, 4);
+    putLE32(header + 48, totalSamples);
+
+    memcpy(header + 52, "data", 4);
+    putLE32(header + 56, dataLen);
+}
+
+void AdpcmStreamDecoder::begin(uint16_t blockAlign) {
+    _blockAlign = blockAlign;
+    _pos = 0;
+    _predictor = 0;
+    _index = 0;
+}
+
+size_t AdpcmStreamDecoder::decode(const uint8_t *in, size_t len, int16_t *out) {
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t b = in[i];
+        // 块头：首个采样 (小端) + 步长索引 + 保留字节，块头本身输出一个采样
+        switch (_pos) {
+            case 0:
+                _predictor = b;
+                break;
+            case 1:
+                _predictor = (int16_t)(_predictor | (b << 8));
+                break;
+            case 2:
+                _index = (b > 88) ? 88 : b;
+                break;
+            case 3:
+                out[n++] = (int16_t)_predictor;
+                break;
+            default:
+                out[n++] = decodeSample(b & 0x0F, _predictor, _index);
+                out[n++] = decodeSample(b >> 4, _predictor, _index);
+                break;
+        }
+        if (++_pos == _blockAlign) _pos = 0;
+    }
+    return n;
+}
+
+size_t AdpcmDecoder::decodeBlock(const uint8_t *block, size_t bytes, int16_t *out) {
+    if (bytes < 4) return 0;
+    if (bytes > ADPCM_BLOCK_BYTES) bytes = ADPCM_BLOCK_BYTES;
+
+    int32_t predictor = (int16_t)(block[0] | (block[1] << 8));
+    int index = block[2];
+    if (index > 88) index = 88;
+
+    size_t n = 0;
+    out[n++] = (int16_t)predictor;
+    for (size_t i = 4; i < bytes; i++) {
+        out[n++] = decodeSample(block[i] & 0x0F, predictor, index);
+        out[n++] = decodeSample(block[i] >> 4, predictor, index);
+    }
+    return n;
+}
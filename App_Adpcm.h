@@ -0,0 +1,78 @@
+#ifndef APP_ADPCM_H
+#define APP_ADPCM_H
+
+#include <Arduino.h>
+
+// IMA-ADPCM (WAV 格式 0x0011，单声道)，16bit PCM 压缩为 4bit，约 4:1
+// 每块 256 字节：4 字节块头 (首个采样 + 步长索引) + 252 字节数据 (每字节两个采样，低半字节在前)
+#define ADPCM_BLOCK_BYTES       256
+#define ADPCM_BLOCK_SAMPLES     ((ADPCM_BLOCK_BYTES - 4) * 2 + 1)   // 505
+#define ADPCM_WAV_HEADER_SIZE   60
+
+// 流式上传时 WAV 头中的未知长度
+#define ADPCM_UNKNOWN_LENGTH    0xFFFFFFFF
+
+/**
+ * 增量编码器：可以按任意大小的分片喂入 PCM，凑满一块就输出一块，
+ * 不足一块的采样留在内部，录音结束时 flush() 输出最后一块。
+ */
+class AdpcmEncoder {
+public:
+    void reset();
+
+    // 喂入 samples 个采样，输出完整的块到 out，返回输出字节数
+    // out 至少需要 maxOutput(samples) 字节
+    size_t encode(const int16_t *pcm, size_t samples, uint8_t *out);
+
+    // 输出最后一个不完整的块 (用最后一个采样补齐到整块)，返回输出字节数
+    size_t flush(uint8_t *out);
+
+    // 已编码的采样总数 (不含补齐部分)
+    uint32_t totalSamples() const { return _total; }
+
+    static size_t maxOutput(size_t samples);
+
+    // 生成 60 字节的 WAV 头 (fmt + fact + data)，totalSamples 未知时传 ADPCM_UNKNOWN_LENGTH
+    static void writeWavHeader(uint8_t *header, uint32_t sampleRate, uint32_t totalSamples);
+
+private:
+    void encodeBlock(const int16_t *pcm, uint8_t *out);
+
+    int16_t _pending[ADPCM_BLOCK_SAMPLES];
+    size_t _count = 0;
+    uint32_t _total = 0;
+    int32_t _predictor = 0;
+    int _index = 0;
+};
+
+/**
+ * 流式解码器 (单声道，块大小任意)：按任意分片喂入 ADPCM 数据直接输出 PCM，
+ * 不缓存整块，内存只有预测器状态；用于边收边放的回复音频。
+ */
+class AdpcmStreamDecoder {
+public:
+    // blockAlign 来自 WAV fmt 块 (ffmpeg 等工具常用 256 / 512 / 1024)
+    void begin(uint16_t blockAlign);
+
+    // 喂入 len 字节，输出到 out，返回采样数；out 至少需要 maxOutput(len) 个采样
+    size_t decode(const uint8_t *in, size_t len, int16_t *out);
+
+    static size_t maxOutput(size_t len) { return len * 2; }
+
+private:
+    uint16_t _blockAlign = ADPCM_BLOCK_BYTES;
+    uint16_t _pos = 0;          // 当前块内的字节位置
+    int32_t _predictor = 0;
+    int _index = 0;
+};
+
+/**
+ * 块解码器：输入一个完整 (或最后一个不完整) 的块，输出 PCM
+ */
+class AdpcmDecoder {
+public:
+    // 解码一个块，返回输出的采样数 (最多 ADPCM_BLOCK_SAMPLES)
+    static size_t decodeBlock(const uint8_t *block, size_t bytes, int16_t *out);
+};
+
+#endif
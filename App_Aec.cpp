@@ -0,0 +1,88 @@
+#include "App_Aec.h"
+
+// 防止参考信号很小时步长爆掉的正则项 (相当于每抽头幅度 32 的底噪)
+#define AEC_NORM_EPS        ((uint64_t)AEC_TAPS * 32 * 32)
+// 双讲检测：按当前的长时回声抑制量 (ERLE) 预测残差应有多大，实际残差高出 9dB 即认为近端有人说话，
+// 判定后保持 50ms。只在滤波器收敛后 (ERLE > 9dB) 启用，否则初始阶段会一直冻结、永远学不会。
+#define AEC_DT_HOLD         800
+#define AEC_DT_MIN_ENERGY   4096    // 残差低于 RMS 64 时不判双讲 (底噪起伏)
+#define AEC_DT_RATIO        8
+#define AEC_SHORT_SHIFT     6       // 短时能量平滑 (64 采样)
+#define AEC_LONG_SHIFT      12      // 长时能量平滑 (4096 采样，约 0.25s)
+#define AEC_CONVERGED_RATIO 8
+// NLMS 步长因子多保留的小数位：g 只在乘完 x[k] 后才移回 Q24，小残差也能继续更新
+#define AEC_GAIN_FRAC       8
+
+void EchoCanceller::reset() {
+    memset(_w, 0, sizeof(_w));
+    memset(_x, 0, sizeof(_x));
+    _pos = 0;
+    _norm = 0;
+    _shortRes = _shortEcho = 0;
+    _longMic = _longRes = 0;
+    _dtHold = 0;
+    _micEnergy = 0;
+    _resEnergy = 0;
+}
+
+void EchoCanceller::process(int16_t *mic, const int16_t *ref, int samples) {
+    uint64_t micE = 0, resE = 0;
+
+    for (int n = 0; n < samples; n++) {
+        // 更新延迟线与能量
+        int32_t xNew = ref[n];
+        int32_t xOld = _x[_pos];
+        _norm += (uint64_t)(xNew * xNew);
+        _norm -= (uint64_t)(xOld * xOld);
+        _x[_pos] = (int16_t)xNew;
+        _x[_pos + AEC_TAPS] = (int16_t)xNew;
+        _pos = (_pos + 1) % AEC_TAPS;
+        // x[0] 为最旧，x[AEC_TAPS-1] 为最新；_w[k] 对应延迟 AEC_TAPS-1-k
+        const int16_t *x = _x + _pos;
+
+        int64_t acc = 0;
+        for (int k = 0; k < AEC_TAPS; k++) {
+            acc += (int64_t)_w[k] * x[k];
+        }
+        int32_t d = mic[n];
+        int32_t e = d - (int32_t)(acc >> 24);
+        if (e > 32767) e = 32767;
+        else if (e < -32768) e = -32768;
+        mic[n] = (int16_t)e;
+
+        micE += (uint64_t)(d * d);
+        resE += (uint64_t)(e * e);
+
+        // 双讲检测
+        int32_t y = d - e;
+        _shortRes += ((int64_t)(e * e) - _shortRes) >> AEC_SHORT_SHIFT;
+        _shortEcho += ((int64_t)y * y - _shortEcho) >> AEC_SHORT_SHIFT;
+        bool converged = _longMic > _longRes * AEC_CONVERGED_RATIO;
+        // shortRes / shortEcho > RATIO * longRes / longMic，交叉相乘避免除法。
+        // 能量都非负，回声估计最大约 2^32、其余 2^30，乘积用无符号 64 位，RATIO 除在左边，响亮播放时也不溢出
+        if (converged && _shortRes > AEC_DT_MIN_ENERGY &&
+            (uint64_t)_shortRes * (uint64_t)_longMic / AEC_DT_RATIO > (uint64_t)_shortEcho * (uint64_t)_longRes) {
+            _dtHold = AEC_DT_HOLD;
+        } else if (_dtHold > 0) {
+            _dtHold--;
+        }
+        // 长时统计只在单讲时更新，近端一直说话也不会把基准抬高
+        if (_dtHold == 0) {
+            _longMic += ((int64_t)(d * d) - _longMic) >> AEC_LONG_SHIFT;
+            _longRes += ((int64_t)(e * e) - _longRes) >> AEC_LONG_SHIFT;
+        }
+
+        // NLMS 更新：w += mu * e * x / (||x||^2 + eps)，双讲时不更新
+        if (_dtHold > 0) continue;
+        // g = mu * e / norm，Q(24 + AEC_GAIN_FRAC)；|e| <= 2^15、norm >= EPS = 2^18，|g| <= 2^27，
+        // 放得进 32 位，抽头更新就是 32x16 乘法
+        int32_t g = (int32_t)(((int64_t)e * AEC_MU_Q15 << (9 + AEC_GAIN_FRAC)) / (int64_t)(_norm + AEC_NORM_EPS));
+        if (g == 0) continue;
+        for (int k = 0; k < AEC_TAPS; k++) {
+            _w[k] += (int32_t)(((int64_t)g * x[k] + (1 << (AEC_GAIN_FRAC - 1))) >> AEC_GAIN_FRAC);
+        }
+    }
+
+    _micEnergy = micE;
+    _resEnergy = resE;
+}
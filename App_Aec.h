@@ -0,0 +1,45 @@
+#ifndef APP_AEC_H
+#define APP_AEC_H
+
+#include <Arduino.h>
+
+// 回声路径模型长度：256 抽头 (16ms @16k)，覆盖 DMA 对齐误差 + 扬声器到麦克风的声学路径
+#define AEC_TAPS            256
+// 步长 mu (Q15)，0.25：更新保留了全部小数位，0.5 在双讲被检测出来之前的几个块里就会把滤波器带偏
+#define AEC_MU_Q15          8192
+
+/**
+ * 定点 NLMS 回声消除
+ * 参考信号是同一时刻扬声器播放的内容 (引擎混音输出)，麦克风信号原地替换为残差。
+ * 内置双讲检测 (残差 vs 回声估计)：近端说话时冻结自适应，避免把人声当回声学掉。
+ */
+class EchoCanceller {
+public:
+    void reset();
+
+    // mic：近端信号 (原地输出残差)；ref：与 mic 逐采样对齐的播放参考
+    void process(int16_t *mic, const int16_t *ref, int samples);
+
+    // 最近是否检测到近端说话 (含拖尾)
+    bool doubleTalk() const { return _dtHold > 0; }
+
+    // 调试用：上一块的麦克风 / 残差能量，比值即回声抑制量
+    uint64_t micEnergy() const { return _micEnergy; }
+    uint64_t residualEnergy() const { return _resEnergy; }
+
+private:
+    int32_t _w[AEC_TAPS];           // 滤波器系数 Q24
+    int16_t _x[AEC_TAPS * 2];       // 参考延迟线 (存两份，免取模)
+    uint16_t _pos = 0;
+    uint64_t _norm = 0;             // 延迟线能量 ||x||^2
+    int64_t _shortRes = 0;          // 残差短时能量
+    int64_t _shortEcho = 0;         // 回声估计短时能量
+    int64_t _longMic = 0;           // 长时能量，用于判断是否收敛
+    int64_t _longRes = 0;
+    uint16_t _dtHold = 0;           // 双讲拖尾 (采样数)
+
+    uint64_t _micEnergy = 0;
+    uint64_t _resEnergy = 0;
+};
+
+#endif
@@ -1,6 +1,5 @@
 #include "App_Audio.h"
 #include <Wire.h>
-#include <math.h>
 #include "Pin_Config.h" 
 #include "driver/gpio.h" // 引入 GPIO 驱动，用于复位引脚
 
@@ -12,7 +11,8 @@ void Audio_Play_Click() {
 }
 
 void Audio_Record_Start() {
-    MyAudio.startRecording();
+    // C 接口没有接收方，只留录音任务那份引用 (录完即回收)
+    MyAudio.releaseRecording(MyAudio.startRecording());
 }
 
 void Audio_Record_Stop() {
@@ -21,9 +21,23 @@ void Audio_Record_Stop() {
 
 // ------------------------------------
 
-struct ToneParams {
-    int freq;
-    int duration;
+// 常驻录音任务的静态栈 (避免每次录音都从堆上分配)
+#define REC_TASK_STACK  4096
+static StackType_t recTaskStack[REC_TASK_STACK];
+static StaticTask_t recTaskTCB;
+void recordTaskWrapper(void *param);
+
+// 预置的提示音序列，freq = 0 为静音间隔
+struct EarconDef {
+    ToneStep steps[SYNTH_MAX_STEPS];
+    uint8_t count;
+};
+
+static const EarconDef earcons[EARCON_COUNT] = {
+    { { {600, 50} }, 1 },                                   // EARCON_FOCUS
+    { { {880, 60}, {0, 30}, {1320, 90} }, 3 },              // EARCON_CONFIRM
+    { { {440, 120}, {0, 40}, {330, 200} }, 3 },             // EARCON_ERROR
+    { { {1320, 60}, {0, 30}, {880, 60}, {0, 30}, {660, 120} }, 5 }, // EARCON_DONE
 };
 
 // ES8311 初始化配置
@@ -45,8 +59,8 @@ void AppAudio::init() {
         return; 
     }
     
-    pinMode(PIN_PA_EN, OUTPUT);
-    digitalWrite(PIN_PA_EN, LOW);
+    // 功放使能脚归编解码器的电源管理控制，上电前先关着
+    codec.begin(&Wire, ES8311_ADDR, PIN_PA_EN);
 
     // --- 修复 2: JTAG 引脚复位 (防止 GPIO 39-42 默认为 JTAG 导致 I2S 异常) ---
     // ESP32-S3 的 GPIO 39-42 默认是 JTAG 调试口，需要强制复位为普通 GPIO
@@ -56,15 +70,76 @@ void AppAudio::init() {
     gpio_reset_pin((gpio_num_t)PIN_I2S_DOUT);
     gpio_reset_pin((gpio_num_t)PIN_I2S_DIN);
 
+    i2sRxLock = xSemaphoreCreateMutex();
+    if (!installI2s(dmaProfile)) return;
+    pipeStartMs = millis();
+
+    // ES8311 Init
+    Serial.println("[Audio] Configuring ES8311...");
+    codec.reset(es8311_init_data, sizeof(es8311_init_data) / 2);
+    
+    setVolume(60);
+    setMicGain(0xBF); 
+    // 初始化后两路都开着；引擎开始运行后按实际需要关掉不用的通路
+    dacLastUse = millis();
+
+    vad.begin(AUDIO_SAMPLE_RATE);
+    micDsp.begin(AUDIO_SAMPLE_RATE);
+    bargeVad.begin(AUDIO_SAMPLE_RATE);
+    aec.reset();
+
+    // 提示音合成器，采样率与 I2S 一致
+    synth.begin(AUDIO_SAMPLE_RATE, 10000);
+    alertSynth.begin(AUDIO_SAMPLE_RATE, 10000);
+
+    // 回复播放抖动缓冲 (PSRAM)
+    streamRing.begin(STREAM_RING_SIZE, STREAM_PREBUFFER_MS * AUDIO_SAMPLE_RATE * 2 / 1000);
+    streamDone = xSemaphoreCreateBinary();
+
+    // 录音对象池：录音段在录音时按需申请，这里只建每个对象的分片通知
+    for (int i = 0; i < REC_POOL_SIZE; i++) {
+        recPool[i].ready = xSemaphoreCreateBinary();
+    }
+
+    // 预录音环形区：从录音段池取一段
+    prerollRing = RecordBuffer::takeSegment();
+    if (prerollRing == NULL) {
+        // 回复播放中仍然读进临时缓冲做回声消除 / 打断检测，只是没有预录音
+        Serial.println("[Audio] Failed to allocate pre-roll ring, pre-roll disabled.");
+    }
+    
+    // 常驻录音任务：静态栈，跟引擎同在音频核心 (Core 0)
+    recordTaskHandle = xTaskCreateStaticPinnedToCore(recordTaskWrapper, "RecTask", REC_TASK_STACK,
+                                                     this, 2, recTaskStack, &recTaskTCB, 0);
+
+    Serial.println("[Audio] Init Done.");
+}
+
+// I2S DMA 配置档：{ dma_buf_count, dma_buf_len }
+static const uint16_t dmaProfiles[AUDIO_DMA_PROFILE_COUNT][2] = {
+    { 4, 64 },      // AUDIO_DMA_LOW_LATENCY
+    { 8, 64 },      // AUDIO_DMA_BALANCED
+    { 4, 256 },     // AUDIO_DMA_THROUGHPUT
+};
+static const char *dmaProfileNames[AUDIO_DMA_PROFILE_COUNT] = { "low-latency", "balanced", "throughput" };
+
+// 回声参考环要装得下最深的发送队列 + 一次读取 + 余量
+static_assert(AUDIO_DMA_MAX_QUEUE_FRAMES + 512 + AEC_BULK_MARGIN < AEC_REF_RING, "AEC reference ring too small");
+
+bool AppAudio::installI2s(uint8_t profile) {
     i2s_config_t i2s_config = {
         .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_RX),
-        .sample_rate = 16000,
+        .sample_rate = AUDIO_SAMPLE_RATE,
         .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+#if AUDIO_I2S_MONO
+        .channel_format = AUDIO_MIC_CHANNEL_FMT,    // 只传麦克风所在声道，RX/TX DMA 带宽减半
+#else
         .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
+#endif
         .communication_format = I2S_COMM_FORMAT_STAND_I2S,
         .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-        .dma_buf_count = 8,
-        .dma_buf_len = 64,
+        .dma_buf_count = dmaProfiles[profile][0],
+        .dma_buf_len = dmaProfiles[profile][1],
         .use_apll = true,
         .tx_desc_auto_clear = true,
         .fixed_mclk = 0
@@ -78,73 +153,592 @@ void AppAudio::init() {
         .data_in_num = PIN_I2S_DIN
     };
 
-    // 安装驱动并检查结果
-    if (i2s_driver_install(i2s_num, &i2s_config, 0, NULL) != ESP_OK) {
+    // 安装驱动并检查结果；事件队列用来统计 DMA 欠载 / 溢出
+    if (i2s_driver_install(i2s_num, &i2s_config, AUDIO_I2S_EVENT_QUEUE, &i2sEvents) != ESP_OK) {
         Serial.println("[Audio] I2S Driver Install Failed!");
-        return;
+        return false;
     }
     i2s_set_pin(i2s_num, &pin_config);
     i2s_zero_dma_buffer(i2s_num);
 
-    // ES8311 Init
-    Serial.println("[Audio] Configuring ES8311...");
-    writeReg(0x00, 0x1F); delay(20); writeReg(0x00, 0x00);
-    for (int i = 0; i < sizeof(es8311_init_data) / 2; i++) {
-        writeReg(es8311_init_data[i][0], es8311_init_data[i][1]);
+    dmaProfile = profile;
+    dmaQueueFrames = dmaProfiles[profile][0] * dmaProfiles[profile][1];
+    dmaBufUs = dmaProfiles[profile][1] * 1000000UL / AUDIO_SAMPLE_RATE;
+    Serial.printf("[Audio] I2S DMA profile: %s (%d x %d frames)\n", dmaProfileNames[profile],
+                  dmaProfiles[profile][0], dmaProfiles[profile][1]);
+    return true;
+}
+
+// ---------------- 音频引擎 ----------------
+// TaskAudio 常驻运行引擎循环：提示音 / 录音启停 / 回复播放 都通过 AudioQueue_Handle 派发，
+// 不再每次按键都 malloc + xTaskCreate。录音任务同样常驻，使用静态栈。
+
+static_assert(TX_CHUNK_FRAMES <= MIXER_BLOCK_FRAMES, "mixer block smaller than I2S TX block");
+
+// I2S 发送块 (按立体声大小分配，单声道模式只用一半)，只由引擎任务使用
+static int16_t txBlock[TX_CHUNK_FRAMES * 2];
+// 提示音通道的单声道渲染缓冲
+static int16_t voicePcm[TX_CHUNK_FRAMES];
+
+bool AppAudio::post(uint8_t type, int param, int param2, Recording *rec) {
+    if (AudioQueue_Handle == NULL) return false;
+    AudioMsg msg = { type, param, param2, rec, (uint32_t)micros() };
+    if (xQueueSend(AudioQueue_Handle, &msg, 0) != pdTRUE) {
+        Serial.printf("[Audio] Queue full, cmd %d dropped!\n", type);
+        return false;
     }
-    
-    setVolume(60);
-    setMicGain(0xBF); 
-    digitalWrite(PIN_PA_EN, HIGH);
+    return true;
+}
+
+void AppAudio::runEngine() {
+    AudioMsg msg;
 
-    // 申请内存
-    record_buffer = (uint8_t *)ps_malloc(MAX_RECORD_SIZE);
-    if (record_buffer == NULL) {
-        Serial.println("[Audio] Failed to allocate PSRAM! Trying malloc...");
-        record_buffer = (uint8_t *)malloc(MAX_RECORD_SIZE);
-    } else {
-        Serial.printf("[Audio] Allocated %d bytes in PSRAM.\n", MAX_RECORD_SIZE);
+    for (;;) {
+        // 有声音在放时只取指令不等待，空闲时阻塞等待下一条指令
+        bool busy = synth.isActive() || alertSynth.isActive() || streamActive;
+        // 推迟的 DMA 配置档切换：发送端空闲、不在录音时才重装驱动
+        if (!busy && pendingDmaProfile != dmaProfile && !isRecording) applyDmaProfile();
+        // 播放通路还没到掉电时间时，最多等到那个时刻再回来关它
+        uint32_t hang = updateCodecPower();
+        TickType_t wait = busy ? 0 : (hang ? pdMS_TO_TICKS(hang) : portMAX_DELAY);
+        while (xQueueReceive(AudioQueue_Handle, &msg, wait) == pdTRUE) {
+            dispatch(msg);
+            wait = 0;
+        }
+        // 新指令要用的通路在写 I2S 之前上电
+        updateCodecPower();
+
+        // 所有通道混成一个块再写 I2S，本任务是 I2S 发送端唯一的写入者
+        if (synth.isActive() || alertSynth.isActive() || streamActive) {
+            mixBlock();
+            pollI2sEvents();
+        }
     }
-    
-    Serial.println("[Audio] Init Done.");
 }
 
-// ---------------- 播放功能 ----------------
+// 重装 I2S 驱动换 DMA 配置档。录音任务的 i2s_read 都在 i2sRxLock 下进行，
+// 拿到锁就保证它不在驱动里；发送端只有本任务，此时没有在写
+void AppAudio::applyDmaProfile() {
+    uint8_t profile = pendingDmaProfile;
+    if (profile >= AUDIO_DMA_PROFILE_COUNT) {
+        pendingDmaProfile = dmaProfile;
+        return;
+    }
+    if (xSemaphoreTake(i2sRxLock, pdMS_TO_TICKS(200)) != pdTRUE) {
+        Serial.println("[Audio] DMA profile change postponed, mic busy.");
+        return;
+    }
+    uint8_t old = dmaProfile;
+    i2s_driver_uninstall(i2s_num);
+    i2sEvents = NULL;
+    if (!installI2s(profile)) {
+        Serial.println("[Audio] Falling back to previous DMA profile.");
+        installI2s(old);
+        pendingDmaProfile = old;
+    }
+    // 发送队列深度变了，回声消除下次播放时重新对齐
+    aecSession++;
+    xSemaphoreGive(i2sRxLock);
+}
 
-void playTaskWrapper(void *param) {
-    ToneParams *p = (ToneParams*)param;
+void AppAudio::dispatch(const AudioMsg &msg) {
+    if (msg.type >= AUDIO_CMD_COUNT) return;
+
+    uint32_t latency = (uint32_t)micros() - msg.post_us;
+    AudioCmdStats &st = cmdStats[msg.type];
+    st.count++;
+    st.last_us = latency;
+    st.total_us += latency;
+    if (latency > st.max_us) st.max_us = latency;
+
+    switch (msg.type) {
+        case AUDIO_CMD_TONE:
+            synth.play(msg.param, msg.param2);
+            break;
+
+        case AUDIO_CMD_EARCON:
+            if (msg.param < EARCON_COUNT) {
+                synth.play(earcons[msg.param].steps, earcons[msg.param].count);
+            }
+            break;
+
+        case AUDIO_CMD_ALERT:
+            if (msg.param < EARCON_COUNT) {
+                alertSynth.play(earcons[msg.param].steps, earcons[msg.param].count);
+            }
+            break;
+
+        case AUDIO_CMD_GAIN:
+            mixer.setGain(msg.param, msg.param2);
+            break;
+
+        case AUDIO_CMD_BARGE_IN:
+            // 录音真正开始了才公布打断，否则网络任务会接手一段空录音、白白掐掉回复
+            if (!armRecording(msg.rec, msg.param)) {
+                releaseRecording(msg.rec);      // 接收方那份引用 (录音任务那份已由 abortRecording 归还)
+                break;
+            }
+            portENTER_CRITICAL(&recPoolMux);
+            bargeRec = msg.rec;
+            portEXIT_CRITICAL(&recPoolMux);
+            bargeIn = true;
+            // 先公布再停回复：网络任务被 streamDone 唤醒时一定能看到 bargeIn
+            if (streamActive) {
+                streamActive = false;
+                duplexActive = false;
+                txLive = false;
+                xSemaphoreGive(streamDone);
+            }
+            Serial.println("[Audio] Barge-in: reply stopped, recording.");
+            break;
+
+        case AUDIO_CMD_REC_START:
+            armRecording(msg.rec, msg.param);
+            break;
+
+        case AUDIO_CMD_REC_STOP:
+            // 指定的录音已经结束 (如 VAD 自动停止) 时不影响之后开始的录音 (如打断录音)
+            if (msg.rec == NULL || msg.rec == activeRec) isRecording = false;
+            break;
+
+        case AUDIO_CMD_STREAM:
+            streamActive = true;
+            streamCarry = 0;
+            txLive = false;
+            if (bargeInEnabled) {
+                // 全双工：录音任务 (预录音循环) 拿播放内容做回声参考
+                aecSession++;
+                duplexActive = true;
+                updateCodecPower();
+                xTaskNotifyGive(recordTaskHandle);
+            }
+            break;
+
+        case AUDIO_CMD_DMA_PROFILE:
+            // 实际切换在引擎空闲时进行 (runEngine)
+            if (msg.param < AUDIO_DMA_PROFILE_COUNT) pendingDmaProfile = msg.param;
+            break;
+    }
+}
+
+// 混出一个块：提示音 / 告警 / 回复三路按各自增益叠加，饱和后整块写入 I2S
+void AppAudio::mixBlock() {
     size_t bytes_written;
-    int sample_rate = 44100;
-    int samples = (sample_rate * p->duration) / 1000;
-    
-    int16_t chunk[1024];  
-    int chunk_size = 1024; 
-    int total_processed = 0;
-    
-    while(total_processed < samples) {
-        int to_process = (samples - total_processed) > (chunk_size/2) ? (chunk_size/2) : (samples - total_processed);
-        for(int i=0; i<to_process; i++) {
-            int16_t val = (int16_t)(10000 * sin(2 * PI * p->freq * (total_processed + i) / sample_rate));
-            chunk[i*2] = val;     // Left
-            chunk[i*2+1] = val;   // Right
+    uint32_t t0 = (uint32_t)micros();
+    uint32_t busy = 0;
+    bool streamed = false;
+    mixer.begin();
+
+    if (synth.isActive()) {
+        int n = synth.render(voicePcm, TX_CHUNK_FRAMES);
+        mixer.mix(MIX_VOICE_EARCON, voicePcm, n);
+    }
+    if (alertSynth.isActive()) {
+        int n = alertSynth.render(voicePcm, TX_CHUNK_FRAMES);
+        mixer.mix(MIX_VOICE_ALERT, voicePcm, n);
+    }
+    if (streamActive) {
+        // 有提示音时不等回复数据，保证提示音按时输出；只放回复时短等待，欠载时也能及时回来处理新指令。
+        // 全双工时不等待：欠载就写静音，保证发送端连续，回声参考与麦克风的对齐关系不变
+        TickType_t wait = (mixer.frames() > 0 || duplexActive) ? 0 : pdMS_TO_TICKS(20);
+        busy += (uint32_t)micros() - t0;
+        int n = readStream(wait);
+        t0 = (uint32_t)micros();
+        mixer.mix(MIX_VOICE_STREAM, streamPcm, n);
+        streamed = (n > 0);
+    }
+
+    uint32_t clipped = mixer.clipCount();
+#if AUDIO_I2S_MONO
+    int frames = mixer.outputMono(txBlock);
+#else
+    int frames = mixer.output(txBlock);
+#endif
+    clipped = mixer.clipCount() - clipped;
+    bool duplex = duplexActive;
+    if (frames == 0 && duplex) {
+        frames = TX_CHUNK_FRAMES;
+        memset(txBlock, 0, frames * AUDIO_I2S_FRAME_BYTES);
+    }
+    if (frames > 0) {
+        if (duplex) pushEchoRef(txBlock, frames);
+        uint32_t w0 = (uint32_t)micros();
+        busy += w0 - t0;
+        i2s_write(i2s_num, txBlock, frames * AUDIO_I2S_FRAME_BYTES, &bytes_written, portMAX_DELAY);
+        uint32_t blocked = (uint32_t)micros() - w0;
+        // 回复真正开始出声后，TX DMA 被取空才算欠载 (预缓冲期间和提示音间隙不算)
+        if (streamed || duplex) txLive = streamActive;
+
+        portENTER_CRITICAL(&statsMux);
+        pipe.tx_writes++;
+        pipe.tx_clipped += clipped;
+        pipe.tx_blocked_us += blocked;
+        if (blocked > pipe.tx_blocked_max_us) pipe.tx_blocked_max_us = blocked;
+        pipe.engine_busy_us += busy;
+        portEXIT_CRITICAL(&statsMux);
+
+        if (duplex) {
+            // 记下 "写完时已排队的采样总数 + 时间"，录音任务据此算出当前正在播放哪个采样
+            portENTER_CRITICAL(&aecMux);
+            aecStampCount = aecTxCount;
+            aecStampUs = (uint32_t)micros();
+            portEXIT_CRITICAL(&aecMux);
         }
-        
-        i2s_write(I2S_NUM_0, chunk, to_process * 4, &bytes_written, portMAX_DELAY);
-        total_processed += to_process;
     }
+}
 
-    free(p);
-    vTaskDelete(NULL); 
+// 把本块发送数据 (单声道) 记入回声参考环
+void AppAudio::pushEchoRef(const int16_t *tx, int frames) {
+    uint32_t n = aecTxCount;
+    for (int i = 0; i < frames; i++) {
+        aecRef[(n + i) & (AEC_REF_RING - 1)] = tx[i * (AUDIO_I2S_MONO ? 1 : 2)];
+    }
+    aecTxCount = n + frames;
 }
 
+// 从抖动缓冲读出一块回复音频到 streamPcm，返回采样数；回复放完时收尾
+int AppAudio::readStream(TickType_t wait) {
+    uint8_t *buf = (uint8_t *)streamPcm;
+
+    // 上一块剩下的奇数字节 (半个样本) 放到本块开头拼接
+    if (streamCarry) buf[0] = streamTail;
+    int len = streamRing.read(buf + streamCarry, sizeof(streamPcm) - streamCarry, wait);
+    if (len == 0) {
+        if (streamRing.isFinished()) {
+            size_t bytes_written;
+            uint8_t silence[128] = {0};
+            i2s_write(i2s_num, silence, 128, &bytes_written, portMAX_DELAY);
+            streamActive = false;
+            duplexActive = false;
+            txLive = false;
+            xSemaphoreGive(streamDone);
+        }
+        return 0;
+    }
+    len += streamCarry;
+
+    // 奇数字节先记下来，本块混音完成后才能覆盖缓冲区
+    streamCarry = len & 1;
+    if (streamCarry) streamTail = buf[len - 1];
+    return len / 2;
+}
+
+// 取走驱动事件：回复出声后的 TX 队列溢出 = 发送端欠载，录音任务在读时的 RX 队列溢出 = 丢帧。
+// 空闲时 DMA 本来就在空转 / 溢出，那时的事件不计
+void AppAudio::pollI2sEvents() {
+    if (i2sEvents == NULL) return;
+    i2s_event_t evt;
+    while (xQueueReceive(i2sEvents, &evt, 0) == pdTRUE) {
+        portENTER_CRITICAL(&statsMux);
+        if (evt.type == I2S_EVENT_TX_Q_OVF) {
+            if (txLive) pipe.tx_underruns++;
+        } else if (evt.type == I2S_EVENT_RX_Q_OVF) {
+            if (rxLive) pipe.rx_overruns++;
+        } else if (evt.type == I2S_EVENT_DMA_ERROR) {
+            pipe.dma_errors++;
+        }
+        portEXIT_CRITICAL(&statsMux);
+    }
+}
+
+AudioPipelineStats AppAudio::getPipelineStats() {
+    AudioPipelineStats s;
+    portENTER_CRITICAL(&statsMux);
+    s = pipe;
+    s.cap_latency_avg_us = capLatencyCount ? (uint32_t)(capLatencyTotal / capLatencyCount) : 0;
+    portEXIT_CRITICAL(&statsMux);
+
+    s.dma_profile = dmaProfile;
+    s.dma_buf_count = dmaProfiles[dmaProfile][0];
+    s.dma_buf_len = dmaProfiles[dmaProfile][1];
+    s.elapsed_ms = millis() - pipeStartMs;
+    s.cpu_permille = s.elapsed_ms ? (uint16_t)((s.engine_busy_us + s.rec_busy_us) / s.elapsed_ms) : 0;
+    return s;
+}
+
+void AppAudio::resetPipelineStats() {
+    portENTER_CRITICAL(&statsMux);
+    pipe = {};
+    capLatencyTotal = 0;
+    capLatencyCount = 0;
+    pipeStartMs = millis();
+    portEXIT_CRITICAL(&statsMux);
+}
+
+void AppAudio::printPipelineStats() {
+    AudioPipelineStats s = getPipelineStats();
+    AudioRingBuffer::Stats r = getStreamStats();
+    Serial.printf("[Audio] DMA %s (%d x %d), window %u ms, CPU %u.%u%% (engine %u ms, rec %u ms)\n",
+                  dmaProfileNames[s.dma_profile], s.dma_buf_count, s.dma_buf_len, s.elapsed_ms,
+                  s.cpu_permille / 10, s.cpu_permille % 10,
+                  (uint32_t)(s.engine_busy_us / 1000), (uint32_t)(s.rec_busy_us / 1000));
+    Serial.printf("[Audio] TX writes=%u underrun=%u blocked=%u ms (max %u us)\n",
+                  s.tx_writes, s.tx_underruns, (uint32_t)(s.tx_blocked_us / 1000), s.tx_blocked_max_us);
+    // 增益由引擎任务修改，这里只读 (32 位读写是原子的)
+    Serial.printf("[Audio] Mixer clipped=%u gain stream/earcon/alert=%d/%d/%d%%\n", s.tx_clipped,
+                  (int)(mixer.getGain(MIX_VOICE_STREAM) * 100 / MIX_GAIN_UNITY),
+                  (int)(mixer.getGain(MIX_VOICE_EARCON) * 100 / MIX_GAIN_UNITY),
+                  (int)(mixer.getGain(MIX_VOICE_ALERT) * 100 / MIX_GAIN_UNITY));
+    Serial.printf("[Audio] RX reads=%u overrun=%u short=%u backlog=%u blocked=%u ms (max %u us), dma_err=%u\n",
+                  s.rx_reads, s.rx_overruns, s.rx_short_reads, s.rx_backlog_reads,
+                  (uint32_t)(s.rx_blocked_us / 1000), s.rx_blocked_max_us, s.dma_errors);
+    Serial.printf("[Audio] Capture latency last=%u avg=%u max=%u us\n",
+                  s.cap_latency_last_us, s.cap_latency_avg_us, s.cap_latency_max_us);
+    if (s.aec_samples) {
+        // 实时占用：每采样周期数 x 采样率 / 主频
+        uint32_t cps = (uint32_t)(s.aec_cycles / s.aec_samples);
+        uint32_t permille = (uint32_t)((uint64_t)cps * AUDIO_SAMPLE_RATE / (getCpuFrequencyMhz() * 1000));
+        Serial.printf("[Audio] AEC %u cycles/sample over %u samples, %u.%u%% of a core\n",
+                      cps, s.aec_samples, permille / 10, permille % 10);
+    }
+    Serial.printf("[Audio] Reply ring underrun=%u overrun=%u fill(min/avg/max)=%u/%u/%u of %u\n",
+                  r.underruns, r.overruns, r.min_fill, r.avg_fill, r.max_fill, r.capacity);
+}
+
+void AppAudio::setDmaProfile(AudioDmaProfile profile) {
+    post(AUDIO_CMD_DMA_PROFILE, profile);
+}
+
+// 按当前用到的通路切换编解码器电源 (只在引擎任务中调用)：发送端有声音就开 DAC，
+// 空闲 CODEC_DAC_HANG_MS 后才关；录音任务在读麦克风 (录音 / 预录音 / 全双工) 就开 ADC。
+// 返回距离 DAC 掉电还剩多少 ms，0 = 不用等
+uint32_t AppAudio::updateCodecPower() {
+    bool busy = synth.isActive() || alertSynth.isActive() || streamActive;
+    bool adc = isRecording || duplexActive || (prerollEnabled && prerollRing != NULL);
+    uint32_t now = millis();
+    if (busy) dacLastUse = now;
+    uint32_t idle = now - dacLastUse;
+    bool dac = busy || (CODEC_POWER_HAS_DAC(codec.power()) && idle < CODEC_DAC_HANG_MS);
+
+    CodecPower target = adc ? (dac ? CODEC_POWER_DUPLEX : CODEC_POWER_ADC)
+                            : (dac ? CODEC_POWER_DAC : CODEC_POWER_OFF);
+    if (target != codec.power()) codec.setPower(target);
+    return (dac && !busy) ? CODEC_DAC_HANG_MS - idle : 0;
+}
+
+void AppAudio::printCodecStats() {
+    codec.printStats();
+}
+
+AudioCmdStats AppAudio::getCmdStats(uint8_t type) {
+    AudioCmdStats empty = {};
+    return (type < AUDIO_CMD_COUNT) ? cmdStats[type] : empty;
+}
+
+void AppAudio::printCmdStats() {
+    static const char *names[AUDIO_CMD_COUNT] = { "Tone", "RecStart", "RecStop", "Stream", "Earcon", "Alert", "Gain", "BargeIn", "DmaProf" };
+    for (int i = 0; i < AUDIO_CMD_COUNT; i++) {
+        const AudioCmdStats &st = cmdStats[i];
+        uint32_t avg = st.count ? (uint32_t)(st.total_us / st.count) : 0;
+        Serial.printf("[Audio] %-8s n=%u last=%uus avg=%uus max=%uus\n",
+                      names[i], st.count, st.last_us, avg, st.max_us);
+    }
+}
+
+// ---------------- 播放功能 ----------------
+
 void AppAudio::playToneAsync(int freq, int duration_ms) {
-    ToneParams *params = (ToneParams*)malloc(sizeof(ToneParams));
-    if(params) {
-        params->freq = freq;
-        params->duration = duration_ms;
-        xTaskCreate(playTaskWrapper, "PlayTask", 4096, params, 1, NULL);
-        Serial.println("[Audio] Play task started");
+    post(AUDIO_CMD_TONE, freq, duration_ms);
+}
+
+void AppAudio::playEarcon(Earcon id) {
+    post(AUDIO_CMD_EARCON, id);
+}
+
+void AppAudio::playAlert(Earcon id) {
+    post(AUDIO_CMD_ALERT, id);
+}
+
+void AppAudio::setVoiceGain(MixVoice voice, uint8_t percent) {
+    post(AUDIO_CMD_GAIN, voice, (int)percent * MIX_GAIN_UNITY / 100);
+}
+
+bool AppAudio::playStream(Stream *src, WiFiClient *net, int length, ReplyCodec codec, Print *tee) {
+    if (!src || !net) return false;
+    return playSource(src, net, length, codec, tee);
+}
+
+bool AppAudio::playCached(Stream *src, int length, ReplyCodec codec) {
+    if (!src) return false;
+    return playSource(src, NULL, length, codec, NULL);
+}
+
+bool AppAudio::playSource(Stream *src, WiFiClient *net, int length, ReplyCodec codec, Print *tee) {
+    if (length <= 0) return false;
+    if (codec == REPLY_CODEC_UNSUPPORTED) {
+        Serial.println("[Audio] Reply codec not supported by this firmware, skipping audio.");
+        return false;
+    }
+
+    Serial.printf("[Audio] Start Playing %s, len: %d\n", net ? "Stream" : "Cached", length);
+    
+    uint8_t buf[1024]; 
+    int remaining = length;
+    bool started = false;
+    uint32_t data_left = 0;
+    bool tee_ok = true;
+    uint32_t tx_underruns = getPipelineStats().tx_underruns;
+
+    replyWav.reset();
+    replyCarry = 0;
+    dropBargeIn();
+
+    while (remaining > 0 && (net == NULL || net->connected()) && !bargeIn) {
+        int to_read = (remaining > sizeof(buf)) ? sizeof(buf) : remaining;
+        int len = src->readBytes(buf, to_read);
+        
+        if (len == 0) break;
+        remaining -= len;
+        if (tee && tee->write(buf, len) != (size_t)len) {
+            Serial.println("[Audio] Reply tee write failed.");
+            tee = NULL;
+            tee_ok = false;
+        }
+
+        // 先增量解析 WAV 头 (可能跨多个分片)，定位到 data 块后才开始播放
+        size_t off = 0;
+        if (!started) {
+            off = replyWav.feed(buf, len);
+            if (replyWav.state() == WAV_NEED_MORE) continue;
+
+            const WavFormat &f = replyWav.format();
+            if (!replyWav.isPlayable()) {
+                Serial.printf("[Audio] Unsupported reply: state=%d fmt=%d ch=%d rate=%d bits=%d\n",
+                              replyWav.state(), f.format, f.channels, f.sampleRate, f.bits);
+                break;
+            }
+            Serial.printf("[Audio] Reply fmt=0x%x %d Hz, %d ch, %d bit (header %d bytes)\n",
+                          f.format, f.sampleRate, f.channels, f.bits, replyWav.headerBytes());
+            if ((codec == REPLY_CODEC_IMA_ADPCM) != (f.format == WAV_FORMAT_IMA_ADPCM)) {
+                Serial.println("[Audio] audio_format does not match WAV header, following the header.");
+            }
+            if (f.format == WAV_FORMAT_IMA_ADPCM) replyAdpcm.begin(f.blockAlign);
+            replyResampler.begin(f.sampleRate, AUDIO_SAMPLE_RATE);
+            // 流式 TTS 的 data 长度常填 0 或 0xFFFFFFFF，此时以外层长度为准
+            data_left = (f.dataBytes == 0 || f.dataBytes == 0xFFFFFFFF) ? 0xFFFFFFFF : f.dataBytes;
+
+            // 网络任务只负责往抖动缓冲里灌数据，播放由音频引擎在 Core 0 上完成
+            streamRing.reset();
+            xSemaphoreTake(streamDone, 0);
+            if (!post(AUDIO_CMD_STREAM)) return false;
+            started = true;
+        }
+
+        // data 块之后的附加块 (如 LIST) 不送去播放
+        uint32_t n = len - off;
+        if (n > data_left) n = data_left;
+        data_left -= n;
+        feedReply(buf + off, n);
+        if (data_left == 0) break;
+    }
+    // data 块收完，或流式长度下外层数据全部收完
+    bool complete = (data_left == 0 || remaining == 0) && !bargeIn && tee_ok;
+
+    if (!started) {
+        Serial.println("[Audio] No playable audio in reply.");
+        return false;
+    }
+
+    streamRing.finish();
+    xSemaphoreTake(streamDone, portMAX_DELAY);
+    if (bargeIn) {
+        Serial.println("[Audio] Reply interrupted by user.");
+        complete = false;
+    }
+
+    AudioRingBuffer::Stats st = getStreamStats();
+    Serial.printf("[Audio] Play Done. underrun=%d overrun=%d dma_underrun=%d fill(min/avg/max)=%d/%d/%d of %d\n",
+                  st.underruns, st.overruns, getPipelineStats().tx_underruns - tx_underruns,
+                  st.min_fill, st.avg_fill, st.max_fill, st.capacity);
+    return complete;
+}
+
+// 一帧 (单声道 / 立体声，8 / 16bit) 转成一个单声道 16bit 采样
+static int16_t frameToMono(const uint8_t *p, const WavFormat &f) {
+    if (f.bits == 8) {
+        int32_t s = (int32_t)p[0] - 128;
+        if (f.channels == 2) s = (s + (int32_t)p[1] - 128) >> 1;
+        return (int16_t)(s << 8);
     }
+    int32_t s = (int16_t)(p[0] | (p[1] << 8));
+    if (f.channels == 2) s = (s + (int16_t)(p[2] | (p[3] << 8))) >> 1;
+    return (int16_t)s;
+}
+
+// 回复音频数据 -> 单声道 -> 重采样 -> 抖动缓冲；不完整的帧留到下一个分片拼接
+void AppAudio::feedReply(const uint8_t *data, size_t len) {
+    const WavFormat &f = replyWav.format();
+
+    if (f.format == WAV_FORMAT_IMA_ADPCM) {
+        // 流式解码：每次最多 REPLY_IN_FRAMES / 2 字节，输出不超过 replyIn
+        while (len > 0) {
+            size_t n = (len > REPLY_IN_FRAMES / 2) ? REPLY_IN_FRAMES / 2 : len;
+            size_t samples = replyAdpcm.decode(data, n, replyIn);
+            data += n;
+            len -= n;
+            size_t out = replyResampler.process(replyIn, samples, replyOut);
+            pushReply(replyOut, out);
+        }
+        return;
+    }
+
+    const size_t frame = f.blockAlign;
+
+    while (len > 0) {
+        size_t n = 0;
+
+        if (replyCarry) {
+            size_t need = frame - replyCarry;
+            if (need > len) need = len;
+            memcpy(replyFrame + replyCarry, data, need);
+            replyCarry += need;
+            data += need;
+            len -= need;
+            if (replyCarry < frame) return;
+            replyIn[n++] = frameToMono(replyFrame, f);
+            replyCarry = 0;
+        }
+
+        while (n < REPLY_IN_FRAMES && len >= frame) {
+            replyIn[n++] = frameToMono(data, f);
+            data += frame;
+            len -= frame;
+        }
+        if (n < REPLY_IN_FRAMES && len > 0) {
+            memcpy(replyFrame, data, len);
+            replyCarry = len;
+            len = 0;
+        }
+
+        size_t out = replyResampler.process(replyIn, n, replyOut);
+        pushReply(replyOut, out);
+    }
+}
+
+void AppAudio::pushReply(const int16_t *pcm, size_t samples) {
+    const uint8_t *bytes = (const uint8_t *)pcm;
+    size_t len = samples * 2;
+
+    // 缓冲满时等待播放腾出空间 (反压)，I2S 正常消费时不会长时间阻塞；
+    // 分段等待，被打断时引擎不再消费，这里能及时退出
+    size_t written = 0;
+    int stalls = 0;
+    while (written < len && !bargeIn) {
+        size_t n = streamRing.write(bytes + written, len - written, pdMS_TO_TICKS(100));
+        if (n == 0 && ++stalls >= 10) {
+            Serial.println("[Audio] Playback stalled, dropping data.");
+            break;
+        }
+        written += n;
+    }
+}
+
+void AppAudio::setPrebufferMs(int ms) {
+    streamRing.setPrebuffer(ms * AUDIO_SAMPLE_RATE * 2 / 1000);
+}
+
+AudioRingBuffer::Stats AppAudio::getStreamStats() {
+    return streamRing.getStats();
 }
 
 // ---------------- 录音功能 ----------------
@@ -152,107 +746,517 @@ void AppAudio::playToneAsync(int freq, int duration_ms) {
 void recordTaskWrapper(void *param) {
     AppAudio *audio = (AppAudio *)param;
     audio->_recordTask(NULL); 
-    vTaskDelete(NULL);
 }
 
+#if !AUDIO_I2S_MONO
+// 立体声交织 -> 麦克风单声道 (取每帧第一个采样)，支持 dst == src 原地压缩。
+// 4 字节对齐时每次处理两帧：读两个 32 位字，拼成一个 32 位字写出；写位置永远不超过读位置。
+static void deinterleaveMic(int16_t *dst, const int16_t *src, int frames) {
+    int i = 0;
+    if ((((uintptr_t)dst | (uintptr_t)src) & 3) == 0) {
+        const uint32_t *in = (const uint32_t *)src;
+        uint32_t *out = (uint32_t *)dst;
+        int pairs = frames / 2;
+        for (int p = 0; p < pairs; p++) {
+            uint32_t a = in[2 * p];
+            uint32_t b = in[2 * p + 1];
+            out[p] = (a & 0xFFFF) | (b << 16);
+        }
+        i = pairs * 2;
+    }
+    for (; i < frames; i++) {
+        dst[i] = src[i * 2];
+    }
+}
+#endif
+
+// 立体声读入的暂存区：录音段里只放单声道，交织数据先读到这里再抽取；
+// 没有预录音环形区时，全双工采集也读在这里
+static int16_t micStereo[512 * 2];
+
 void AppAudio::_recordTask(void *param) {
     size_t bytes_read;
-    const int samples_per_chunk = 512;
-    int16_t i2s_read_buff[samples_per_chunk * 2]; 
+    // 每次最多读 512 帧 (32ms)，直接读进当前录音段，不跨段 (跨段时这一次少读一些)
+    const uint32_t frames_per_read = 512;
 
-    while (isRecording) {
-        i2s_read(i2s_num, i2s_read_buff, sizeof(i2s_read_buff), &bytes_read, pdMS_TO_TICKS(100));
+    for (;;) {
+        if (!isRecording) {
+            // 空闲时持续往预录音环形区里录 (环形区独立于录音段，上传期间也不停)；
+            // 关闭预录音时阻塞等待，引擎收到 AUDIO_CMD_REC_START 或开始全双工播放后唤醒
+            if (!duplexActive && (!prerollEnabled || prerollRing == NULL)) {
+                prerollPos = 0;
+                prerollFill = 0;
+                rxLive = false;
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            } else {
+                capturePreroll();
+            }
+            continue;
+        }
 
-        if (bytes_read > 0) {
-            int frames = bytes_read / 4; 
+        Recording *rec = activeRec;
+        bargePosted = false;
+        vad.reset();
+        uint32_t preroll = beginUtterance(rec);
+        uint32_t published = 0; // 已发布给网络任务的字节数 (含 WAV 头)
+        uint32_t lead_trimmed = 0;
+        uint32_t last_signal = millis();   // 最近一次唤醒网络任务 (分片或心跳) 的时间
+        uint32_t rx_overruns = getPipelineStats().rx_overruns;
 
-            if (record_data_len + (frames * 2) >= MAX_RECORD_SIZE) {
+        while (isRecording && rec->len > 0) {
+            uint32_t room;
+            uint8_t *dst = rec->buf.writePtr(rec->len, &room);
+            if (dst == NULL) {
                 Serial.println("[Audio] Buffer Full!");
                 isRecording = false;
                 break;
             }
+            uint32_t want = room / 2;
+            if (want > frames_per_read) want = frames_per_read;
+
+            uint32_t rx_us;
+#if AUDIO_I2S_MONO
+            bytes_read = readMic(dst, want * AUDIO_I2S_FRAME_BYTES, &rx_us);
+#else
+            bytes_read = readMic(micStereo, want * AUDIO_I2S_FRAME_BYTES, &rx_us);
+#endif
+
+            if (bytes_read > 0) {
+                int frames = bytes_read / AUDIO_I2S_FRAME_BYTES;
+#if !AUDIO_I2S_MONO
+                deinterleaveMic((int16_t *)dst, micStereo, frames);
+#endif
+                micDsp.process((int16_t *)dst, frames);
+                rec->len += (frames * 2);
+                noteCapture(frames, rx_us, (uint32_t)micros());
+
+                // 发布上限：默认是全部已录数据
+                uint32_t limit = rec->len;
 
-            int16_t *psram_ptr = (int16_t *)(record_buffer + record_data_len);
-            
-            for (int i = 0; i < frames; i++) {
-                psram_ptr[i] = i2s_read_buff[i * 2]; 
+                if (vadEnabled) {
+                    vad.process((const int16_t *)dst, frames);
+
+                    if (!vad.speechDetected()) {
+                        // 还没开口：只保留最近 VAD_LEAD_PAD_MS 的音频，攒到两倍时整体前移一次
+                        // (段不归还，后面的录音直接覆盖)
+                        uint32_t pcm = rec->len - 44;
+                        if (pcm >= 2 * VAD_LEAD_PAD_BYTES) {
+                            rec->buf.copyWithin(44, rec->len - VAD_LEAD_PAD_BYTES, VAD_LEAD_PAD_BYTES);
+                            rec->len = 44 + VAD_LEAD_PAD_BYTES;
+                            lead_trimmed += pcm - VAD_LEAD_PAD_BYTES;
+                        }
+                        limit = published; // 开口前不发布任何分片
+                    } else {
+                        // 说完后的静音先压着不发，只放行 VAD_TRAIL_PAD_MS；用户继续说话时再补发
+                        uint32_t silence = vad.silenceSamples() * 2;
+                        if (silence > VAD_TRAIL_PAD_BYTES) limit = rec->len - (silence - VAD_TRAIL_PAD_BYTES);
+
+                        // 可选：静音超过挂起时间自动结束录音
+                        if (recAutoStopMs > 0 && vad.silenceMs() >= recAutoStopMs) {
+                            Serial.printf("[Audio] VAD: %d ms silence, auto stop.\n", vad.silenceMs());
+                            isRecording = false;
+                        }
+                    }
+                }
+
+                // 凑满整块就发布；网络任务落后时不用等它，下次取分片会把已发布的部分一起取走。
+                // 没有可发布的数据时定期发心跳，网络任务不会把长时间的静音当成录音出错
+                uint32_t now = millis();
+                if (limit >= published + REC_CHUNK_BYTES) {
+                    published = limit - (limit - published) % REC_CHUNK_BYTES;
+                    rec->published = published;
+                    xSemaphoreGive(rec->ready);
+                    last_signal = now;
+                } else if (now - last_signal >= REC_KEEPALIVE_MS) {
+                    xSemaphoreGive(rec->ready);
+                    last_signal = now;
+                }
+            }
+            else {
+                vTaskDelay(1);
             }
+        }
+        isRecording = false;
 
-            record_data_len += (frames * 2);
+        // 裁掉结尾静音 (只保留 VAD_TRAIL_PAD_MS)，已发布的部分不会被裁掉
+        uint32_t tail_trimmed = 0;
+        if (vadEnabled && vad.speechDetected()) {
+            uint32_t silence = vad.silenceSamples() * 2;
+            if (silence > VAD_TRAIL_PAD_BYTES) {
+                uint32_t end = rec->len - (silence - VAD_TRAIL_PAD_BYTES);
+                if (end < published) end = published;
+                tail_trimmed = rec->len - end;
+                rec->len = end;
+            }
         }
-        else {
-            vTaskDelay(1);
+        if (vadEnabled) {
+            Serial.printf("[Audio] VAD: speech=%d, trimmed lead %d ms, tail %d ms\n", vad.speechDetected(),
+                          lead_trimmed / (AUDIO_SAMPLE_RATE * 2 / 1000), tail_trimmed / (AUDIO_SAMPLE_RATE * 2 / 1000));
         }
+
+        // 回填真实长度的 WAV 头
+        uint32_t pcm_size = (rec->len > 44) ? rec->len - 44 : 0;
+        if (rec->len >= 44) {
+            uint8_t header[44];
+            createWavHeader(header, pcm_size, AUDIO_SAMPLE_RATE, 16, 1);
+            rec->buf.write(0, header, 44);
+        }
+        Serial.printf("[Audio] Stop. PCM Size: %d bytes (Mono, 16k), %d segments (peak %d, %d pooled), RX overruns %d\n",
+                      pcm_size, rec->buf.segments(), rec->buf.peakSegments(), RecordBuffer::pooled(),
+                      getPipelineStats().rx_overruns - rx_overruns);
+
+        // 发布最终长度 (最后一个分片可能为空)，网络任务据此结束上传；
+        // 然后放掉录音任务这份引用，段由最后一个持有者还给池
+        rec->published = rec->len;
+        rec->done = true;
+        xSemaphoreGive(rec->ready);
+        activeRec = NULL;
+        if (recDoneCb) recDoneCb(rec, rec->len, recDoneCtx);
+        releaseRecording(rec);
+        // 上次换环形区时段池 / PSRAM 不够：段刚还回池里，再试一次
+        if (prerollRing == NULL) prerollRing = RecordBuffer::takeSegment();
     }
-    
-    recordTaskHandle = NULL;
-    vTaskDelete(NULL);
 }
 
-void AppAudio::startRecording() {
-    if (isRecording) {
-        Serial.println("[Audio] Already recording...");
+// 读麦克风：i2s_read 在 i2sRxLock 下进行 (引擎重装驱动时会拿这把锁)，
+// 顺带取走驱动事件、记录阻塞时间；doneUs 返回读完的时刻
+size_t AppAudio::readMic(void *dst, size_t bytes, uint32_t *doneUs) {
+    size_t bytes_read = 0;
+    if (!rxLive) {
+        // 刚从阻塞中恢复：空闲期间 RX DMA 溢出的事件不算
+        xSemaphoreTake(i2sRxLock, portMAX_DELAY);
+        pollI2sEvents();
+        xSemaphoreGive(i2sRxLock);
+        rxLive = true;
+    }
+
+    xSemaphoreTake(i2sRxLock, portMAX_DELAY);
+    uint32_t t0 = (uint32_t)micros();
+    i2s_read(i2s_num, dst, bytes, &bytes_read, pdMS_TO_TICKS(100));
+    uint32_t t1 = (uint32_t)micros();
+    pollI2sEvents();
+    xSemaphoreGive(i2sRxLock);
+
+    // 请求的音频时长一半都不到就读满了：数据早就在 DMA 里排着，读端落后
+    uint32_t blocked = t1 - t0;
+    uint32_t want_us = (uint32_t)((uint64_t)bytes / AUDIO_I2S_FRAME_BYTES * 1000000 / AUDIO_SAMPLE_RATE);
+    portENTER_CRITICAL(&statsMux);
+    pipe.rx_reads++;
+    pipe.rx_blocked_us += blocked;
+    if (blocked > pipe.rx_blocked_max_us) pipe.rx_blocked_max_us = blocked;
+    if (bytes_read < bytes) pipe.rx_short_reads++;
+    else if (want_us > 2 * dmaBufUs && blocked < want_us / 2) pipe.rx_backlog_reads++;
+    portEXIT_CRITICAL(&statsMux);
+
+    *doneUs = t1;
+    return bytes_read;
+}
+
+// 一块麦克风数据处理完：最早的采样已经等了 块长 + DMA 缓冲粒度，再加上处理时间
+void AppAudio::noteCapture(int frames, uint32_t readUs, uint32_t doneUs) {
+    uint32_t proc = doneUs - readUs;
+    uint32_t latency = (uint32_t)((uint64_t)frames * 1000000 / AUDIO_SAMPLE_RATE) + dmaBufUs + proc;
+    portENTER_CRITICAL(&statsMux);
+    pipe.rec_busy_us += proc;
+    pipe.cap_latency_last_us = latency;
+    if (latency > pipe.cap_latency_max_us) pipe.cap_latency_max_us = latency;
+    capLatencyTotal += latency;
+    capLatencyCount++;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+// 预录音：空闲时循环覆盖独立的环形区
+void AppAudio::capturePreroll() {
+    uint8_t *ring = prerollRing;
+
+    // 每次最多 512 帧，不跨越环形区末尾；没有环形区时读进 micStereo，
+    // 只为回声消除 / 打断检测，不留预录音
+    uint32_t frames = ring ? (PREROLL_BYTES - prerollPos) / 2 : 512;
+    if (frames > 512) frames = 512;
+    int16_t *dst = ring ? (int16_t *)(ring + prerollPos) : micStereo;
+    uint32_t rxUs;
+#if AUDIO_I2S_MONO
+    size_t bytes_read = readMic(dst, frames * AUDIO_I2S_FRAME_BYTES, &rxUs);
+#else
+    size_t bytes_read = readMic(micStereo, frames * AUDIO_I2S_FRAME_BYTES, &rxUs);
+#endif
+    if (bytes_read == 0) {
+        vTaskDelay(1);
         return;
     }
-    
-    if (record_buffer != NULL) {
-        record_data_len = 44; 
-    } else {
-        Serial.println("[Audio] No buffer allocated!");
+
+    frames = bytes_read / AUDIO_I2S_FRAME_BYTES;
+#if !AUDIO_I2S_MONO
+    deinterleaveMic(dst, micStereo, frames);
+#endif
+    // 回复播放中：先消除回声，再过前端 (AGC 是非线性的，必须放在 AEC 之后)
+    bool duplex = duplexActive;
+    if (duplex) cancelEcho(dst, frames, rxUs);
+    // 预录音也过前端：拼接后与正式录音连续，降噪的噪声估计也在说话前就收敛了
+    micDsp.process(dst, frames);
+    if (duplex) detectBargeIn(dst, frames);
+    noteCapture(frames, rxUs, (uint32_t)micros());
+    if (ring == NULL) return;
+    prerollPos += frames * 2;
+    if (prerollPos >= PREROLL_BYTES) prerollPos = 0;
+    prerollFill += frames * 2;
+    if (prerollFill > PREROLL_BYTES) prerollFill = PREROLL_BYTES;
+}
+
+// 回声消除：第一次进入某个播放会话时，用引擎的 (采样数, 时间) 戳估算这块麦克风数据
+// 对应的参考位置；之后两边按采样数同步前进 (TX/RX 共用 I2S 时钟，不会漂移)
+void AppAudio::cancelEcho(int16_t *pcm, int frames, uint32_t rxUs) {
+    uint32_t tx = aecTxCount;
+    bool lock = (aecLocked != aecSession);
+    int32_t ahead = (int32_t)(aecRefIdx + frames - tx);
+    if (!lock && (ahead > 0 || (int32_t)(tx - aecRefIdx) > AEC_REF_RING)) {
+        Serial.println("[Audio] AEC lost alignment, re-locking.");
+        lock = true;
+    }
+
+    if (lock) {
+        portENTER_CRITICAL(&aecMux);
+        uint32_t stampCount = aecStampCount;
+        int32_t since = (int32_t)(rxUs - aecStampUs);
+        portEXIT_CRITICAL(&aecMux);
+        // 引擎还没在本会话写过块 (时间戳是旧的)，这块先不处理
+        if (since > 100000 || since < -100000) return;
+
+        // 时间戳时刻正在播放 stampCount - 队列深度；推到本块第一个采样，再留出余量
+        int32_t elapsed = (int32_t)((int64_t)since * AUDIO_SAMPLE_RATE / 1000000);
+        aecRefIdx = stampCount - dmaQueueFrames + elapsed - frames - AEC_BULK_MARGIN;
+        if (aecLocked != aecSession) {
+            aec.reset();
+            bargeVad.reset();
+            duplexStartMs = millis();
+        }
+        aecLocked = aecSession;
+    }
+
+    for (int i = 0; i < frames; i++) {
+        aecRefBlock[i] = aecRef[(aecRefIdx + i) & (AEC_REF_RING - 1)];
+    }
+    aecRefIdx += frames;
+    uint32_t c0 = ESP.getCycleCount();
+    aec.process(pcm, aecRefBlock, frames);
+    uint32_t cycles = ESP.getCycleCount() - c0;
+    portENTER_CRITICAL(&statsMux);
+    pipe.aec_cycles += cycles;
+    pipe.aec_samples += frames;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+// 打断检测：消除回声后的信号里 VAD 确认开口，且回声消除判定为双讲
+void AppAudio::detectBargeIn(const int16_t *pcm, int frames) {
+    if (bargeIn || bargePosted || !vadEnabled) return;
+    bargeVad.process(pcm, frames);
+
+    if (millis() - duplexStartMs < BARGE_IN_MIN_PLAY_MS) {
+        bargeVad.reset();   // 收敛之前的判决不算数
         return;
     }
+    if (!bargeVad.speechDetected() || !aec.doubleTalk()) return;
 
-    isRecording = true;
-    xTaskCreate(recordTaskWrapper, "RecTask", 4096, this, 2, &recordTaskHandle);
+    // 打断后的录音对象在这里取；引擎开始录音后才公布给网络任务 (bargeRec)，
+    // 网络任务 takeBargeIn() 时接手接收方那份引用
+    Recording *rec = acquireRecording();
+    if (rec == NULL) return;
+    Serial.println("[Audio] Barge-in detected.");
+    if (!post(AUDIO_CMD_BARGE_IN, BARGE_IN_AUTO_STOP_MS, 0, rec)) {
+        // 队列满：两份引用都还掉，回复照常播放
+        abortRecording(rec);
+        releaseRecording(rec);
+        return;
+    }
+    bargePosted = true;     // 引擎处理之前的几帧不再重复检测
 }
 
-void AppAudio::stopRecording() {
-    isRecording = false; 
+// 开始一段录音：写流式 WAV 头，把预录音按时间顺序 (先 [pos, end) 再 [0, pos)) 拷到头后面，
+// 同时喂给 VAD。返回拼接的 PCM 字节数；拿不到录音段时 rec->len 为 0
+uint32_t AppAudio::beginUtterance(Recording *rec) {
+    // 预录音：环形区整段交给录音当第一段，逻辑偏移 44 对准最旧的数据，不拷贝。
+    // 环形区已绕过一圈时，WAV 头落在最旧的 44 字节上 (丢掉 22 个采样)；没绕过时落在段尾空闲处
+    uint32_t preroll = 0;
+    rec->len = 0;
+    if (prerollRing != NULL && prerollFill > 0) {
+        bool wrapped = prerollFill >= PREROLL_BYTES;
+        uint32_t lead = wrapped ? prerollPos : PREROLL_BYTES - 44;
+        if (rec->buf.adoptLead(prerollRing, lead)) {
+            preroll = wrapped ? PREROLL_BYTES - 44 : prerollPos;
+            prerollRing = RecordBuffer::takeSegment();
+            if (prerollRing == NULL) Serial.println("[Audio] No segment for a new pre-roll ring.");
+            if (vadEnabled) {
+                RecSpan parts[2];
+                int n = rec->buf.spans(44, preroll, parts, 2);
+                for (int i = 0; i < n; i++) vad.process((const int16_t *)parts[i].data, parts[i].len / 2);
+            }
+        }
+    }
+    prerollPos = 0;
+    prerollFill = 0;
+
+    // 流式 WAV 头：长度未知，先填最大值，停止录音后再回填真实长度
+    uint8_t header[44];
+    createWavHeader(header, 0xFFFFFFFF - 36, AUDIO_SAMPLE_RATE, 16, 1);
+    if (!rec->buf.write(0, header, 44)) {
+        Serial.println("[Audio] No memory for recording!");
+        return 0;
+    }
+    rec->len = 44 + preroll;
+
+    Serial.printf("[Audio] Pre-roll: %d ms spliced.\n", preroll / (AUDIO_SAMPLE_RATE * 2 / 1000));
+    return preroll;
+}
+
+Recording *AppAudio::startRecording() {
+    // 打断留下、没人接手的录音先收回，免得占着池
+    dropBargeIn();
+    Recording *rec = acquireRecording();
+    if (rec == NULL) return NULL;
+    if (!post(AUDIO_CMD_REC_START, 0, 0, rec)) {
+        abortRecording(rec);
+        releaseRecording(rec);
+        return NULL;
+    }
+    return rec;
+}
+
+bool AppAudio::stopRecording(Recording *rec) {
+    // 不等录音任务收尾：最后一次 i2s_read 和回填 WAV 头都在录音任务里完成，
+    // 需要完整 WAV 的一方 (网络任务) 会等到最后一个分片
     Serial.println("[Audio] Stopping recording...");
-    delay(50); 
-    uint32_t pcm_size = record_data_len - 44;
-    Serial.printf("[Audio] Stop. PCM Size: %d bytes (Mono, 16k)\n", pcm_size);
-    createWavHeader(record_buffer, pcm_size, 16000, 16, 1);
+    return post(AUDIO_CMD_REC_STOP, 0, 0, rec);
 }
 
-void AppAudio::playStream(WiFiClient *client, int length) {
-    if (!client || length <= 0) return;
+void AppAudio::setRecordCallback(RecordDoneCallback cb, void *ctx) {
+    recDoneCtx = ctx;
+    recDoneCb = cb;
+}
 
-    Serial.printf("[Audio] Start Playing Stream, len: %d\n", length);
-    digitalWrite(PIN_PA_EN, HIGH); 
-    
-    uint8_t buf[1024]; 
-    size_t bytes_written;
-    int remaining = length;
-    
-    if (remaining > 44) {
-        client->readBytes(buf, 44);
-        remaining -= 44;
+void AppAudio::setVad(bool enable, uint16_t autoStopMs) {
+    vadEnabled = enable;
+    vadAutoStopMs = autoStopMs;
+}
+
+void AppAudio::setBargeIn(bool enable) {
+    bargeInEnabled = enable;
+}
+
+Recording *AppAudio::takeBargeIn() {
+    portENTER_CRITICAL(&recPoolMux);
+    Recording *rec = bargeIn ? bargeRec : NULL;
+    if (rec) bargeRec = NULL;
+    bargeIn = false;
+    portEXIT_CRITICAL(&recPoolMux);
+    return rec;
+}
+
+// 清掉上一次打断的状态；录音对象没被网络任务接手就归还接收方那份引用
+void AppAudio::dropBargeIn() {
+    portENTER_CRITICAL(&recPoolMux);
+    Recording *rec = bargeRec;
+    bargeRec = NULL;
+    bargeIn = false;
+    portEXIT_CRITICAL(&recPoolMux);
+    releaseRecording(rec);
+}
+
+void AppAudio::setMicDsp(uint8_t stages) {
+    micDsp.setStages(stages);
+}
+
+void AppAudio::setPreroll(bool enable) {
+    prerollEnabled = enable;
+    if (recordTaskHandle) xTaskNotifyGive(recordTaskHandle);
+}
+
+// 从录音池取一个空闲对象，录音任务和接收方各算一份引用
+Recording *AppAudio::acquireRecording() {
+    Recording *rec = NULL;
+    portENTER_CRITICAL(&recPoolMux);
+    for (int i = 0; i < REC_POOL_SIZE; i++) {
+        if (!recPool[i].inUse) {
+            rec = &recPool[i];
+            rec->inUse = true;
+            rec->refs = 2;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&recPoolMux);
+    if (rec == NULL) {
+        Serial.println("[Audio] Recording pool exhausted!");
+        return NULL;
     }
+    rec->len = 0;
+    rec->published = 0;
+    rec->consumed = 0;
+    rec->done = false;
+    xSemaphoreTake(rec->ready, 0);
+    return rec;
+}
 
-    while (remaining > 0 && client->connected()) {
-        int to_read = (remaining > sizeof(buf)) ? sizeof(buf) : remaining;
-        int len = client->readBytes(buf, to_read);
-        
-        if (len == 0) break;
+// 引擎任务里开始一次录音 (按键开始 / 打断)，autoStopMs 为 0 时用 VAD 默认的结尾静音；
+// 没能开始时录音任务那份引用已经归还，返回 false
+bool AppAudio::armRecording(Recording *rec, uint32_t autoStopMs) {
+    if (rec == NULL) return false;
+    if (isRecording) {
+        Serial.println("[Audio] Already recording...");
+        abortRecording(rec);
+        return false;
+    }
+    // WAV 头和预录音拼接由录音任务完成 (它独占预录音环形区)
+    recAutoStopMs = autoStopMs ? autoStopMs : vadAutoStopMs;
+    activeRec = rec;
+    isRecording = true;
+    updateCodecPower();     // 关了预录音时 ADC 是掉电的，唤醒录音任务前先开
+    xTaskNotifyGive(recordTaskHandle);
+    return true;
+}
 
-        int samples = len / 2; 
-        int16_t *pcm_samples = (int16_t*)buf;
-        
-        for (int i=0; i<samples; i++) {
-            int16_t frame[2];
-            frame[0] = pcm_samples[i];
-            frame[1] = pcm_samples[i];
-            i2s_write(i2s_num, frame, 4, &bytes_written, portMAX_DELAY);
+// 录音没能开始：直接标记为空录音结束，并放掉录音任务那份引用
+void AppAudio::abortRecording(Recording *rec) {
+    rec->len = 0;
+    rec->published = 0;
+    rec->done = true;
+    xSemaphoreGive(rec->ready);
+    releaseRecording(rec);
+}
+
+void AppAudio::releaseRecording(Recording *rec) {
+    if (rec == NULL) return;
+    portENTER_CRITICAL(&recPoolMux);
+    bool last = (rec->refs > 0 && --rec->refs == 0);
+    portEXIT_CRITICAL(&recPoolMux);
+    if (!last) return;
+
+    // 段还完之前对象仍标记为占用，不会被新录音拿走
+    rec->buf.release();
+    portENTER_CRITICAL(&recPoolMux);
+    rec->inUse = false;
+    portEXIT_CRITICAL(&recPoolMux);
+}
+
+int AppAudio::getRecordSpans(Recording *rec, uint32_t offset, uint32_t len, RecSpan *spans, int maxSpans) {
+    return rec->buf.spans(offset, len, spans, maxSpans);
+}
+
+bool AppAudio::waitChunk(Recording *rec, AudioChunk *chunk, TickType_t wait) {
+    bool woken = false;
+    for (;;) {
+        // 先读 done 再读 published：录音任务是先写最终长度再置 done
+        bool done = rec->done;
+        uint32_t end = rec->published;
+        // 被唤醒但没有新数据 = 录音任务的心跳，返回空分片
+        if (end > rec->consumed || done || woken) {
+            chunk->offset = rec->consumed;
+            chunk->len = end - rec->consumed;
+            chunk->last = done;
+            rec->consumed = end;
+            return true;
         }
-        
-        remaining -= len;
+        if (xSemaphoreTake(rec->ready, wait) != pdTRUE) return false;
+        woken = true;
     }
-    
-    uint8_t silence[128] = {0};
-    i2s_write(i2s_num, silence, 128, &bytes_written, portMAX_DELAY);
-    
-    Serial.println("[Audio] Play Done.");
 }
 
 void AppAudio::createWavHeader(uint8_t *header, uint32_t totalDataLen, uint32_t sampleRate, uint8_t sampleBits, uint8_t numChannels) {
@@ -288,31 +1292,14 @@ void AppAudio::createWavHeader(uint8_t *header, uint32_t totalDataLen, uint32_t
 
 // ---------------- 辅助函数 ----------------
 
+// 音量 / 增益经影子缓存写入，值没变不发 I2C；对应通路掉电时只记下，上电时恢复。
+// I2C 没初始化成功 (缺件) 时 codec 没有锁，直接忽略
 void AppAudio::setVolume(uint8_t vol) {
     if (vol > 100) vol = 100;
     uint8_t reg_val = map(vol, 0, 100, 0, 0xBF);
-    writeReg(0x32, reg_val);
+    codec.setDacVolume(reg_val);
 }
 
 void AppAudio::setMicGain(uint8_t gain) {
-    writeReg(0x14, gain); 
-}
-
-void AppAudio::writeReg(uint8_t reg, uint8_t data) {
-    // 保护：如果 I2C 没初始化成功（缺件），不执行写入，防止崩溃
-    // Wire.begin() 成功后会返回 true，我们在 init 里判断过了
-    // 如果要更严谨，可以加一个成员变量 _initialized 标记
-    Wire.beginTransmission(ES8311_ADDR);
-    Wire.write(reg);
-    Wire.write(data);
-    Wire.endTransmission();
-}
-
-uint8_t AppAudio::readReg(uint8_t reg) {
-    Wire.beginTransmission(ES8311_ADDR);
-    Wire.write(reg);
-    Wire.endTransmission();
-    Wire.requestFrom(ES8311_ADDR, 1);
-    if (Wire.available()) return Wire.read();
-    return 0;
+    codec.setMicGain(gain);
 }
\ No newline at end of file
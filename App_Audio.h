@@ -3,46 +3,394 @@
 #include <WiFi.h> // 新增
 #include <Arduino.h>
 #include <driver/i2s.h>
+#include "App_RingBuffer.h"
+#include "App_Synth.h"
+#include "App_Mixer.h"
+#include "App_Vad.h"
+#include "App_MicDsp.h"
+#include "App_Aec.h"
+#include "App_Wav.h"
+#include "App_Resampler.h"
+#include "App_Adpcm.h"
+#include "App_RecBuffer.h"
+#include "App_Es8311.h"
 
 #define ES8311_ADDR     0x18
 
+// I2S 采样率：录音、提示音合成、回复播放统一使用
+#define AUDIO_SAMPLE_RATE   16000
+
+// I2S 声道模式
+// 1: 单声道，只传麦克风所在的声道 (ES8311 是单声道 codec)，RX/TX DMA 带宽和拷贝量减半
+// 0: 立体声交织，给必须跑双声道的板子用，录音时原地抽取麦克风声道
+#define AUDIO_I2S_MONO          1
+// 单声道模式下麦克风所在的声道 (如果录音全是 0，改为 I2S_CHANNEL_FMT_ONLY_RIGHT)
+#define AUDIO_MIC_CHANNEL_FMT   I2S_CHANNEL_FMT_ONLY_LEFT
+// 每个 I2S 帧的字节数 (16bit x 声道数)
+#define AUDIO_I2S_FRAME_BYTES   (AUDIO_I2S_MONO ? 2 : 4)
+
+// 边录边传：录音任务每凑满一块就发布一个分片 (2048 字节 = 64ms @16k 单声道)
+#define REC_CHUNK_BYTES 2048
+// 没有分片可发 (开口前 / VAD 压着句中停顿) 时，录音任务按这个间隔唤醒一次网络任务，
+// 说明录音还在进行；网络任务以此区分 "用户没在说话" 和 "录音任务卡住"
+#define REC_KEEPALIVE_MS 500
+
+// I2S 发送块大小：每次 i2s_write 写入的立体声帧数
+// dma_buf_len = 64 帧，这里一次填满 4 个 DMA 缓冲 (256 帧 = 1KB)
+#define TX_CHUNK_FRAMES   256
+
+// 回复播放的抖动缓冲：64KB (约 2 秒 @16k 单声道)，默认预缓冲 200ms
+#define STREAM_RING_SIZE        (64 * 1024)
+#define STREAM_PREBUFFER_MS     200
+
+// I2S DMA 配置档，运行时可切换 (setDmaProfile)，不用重新烧录就能在延迟和抗抖动之间取舍
+enum AudioDmaProfile : uint8_t {
+    AUDIO_DMA_LOW_LATENCY,      // 4 x 64 帧 (16ms)：回声路径最短，对调度抖动最敏感
+    AUDIO_DMA_BALANCED,         // 8 x 64 帧 (32ms)：默认
+    AUDIO_DMA_THROUGHPUT,       // 4 x 256 帧 (64ms)：DMA 中断减为 1/4，WiFi 繁忙时不易欠载
+    AUDIO_DMA_PROFILE_COUNT
+};
+#define AUDIO_DMA_DEFAULT_PROFILE   AUDIO_DMA_BALANCED
+#define AUDIO_DMA_MAX_QUEUE_FRAMES  1024    // 各配置档中最大的 count x len
+#define AUDIO_I2S_EVENT_QUEUE       16      // 驱动事件队列 (DMA 欠载 / 溢出)
+
+// 全双工打断 (barge-in)：播放回复时麦克风继续采集，用播放内容做参考消除回声，
+// 检测到用户开口就停止播放并开始新一轮录音
+#define AEC_REF_RING            2048    // 参考信号历史 (采样，2 的幂)，大于 DMA 深度 + 一次读取 + 余量
+#define AEC_BULK_MARGIN         64      // 参考比回声提前的采样数，让回声落在滤波器窗口内
+#define BARGE_IN_MIN_PLAY_MS    300     // 回复开始后多久才允许打断 (等回声消除收敛)
+#define BARGE_IN_AUTO_STOP_MS   800     // 打断后的录音没有按键松开，静音这么久自动结束
+
+// --- 音频引擎指令 (经 AudioQueue_Handle 派发给常驻的 TaskAudio) ---
+enum AudioCmdType : uint8_t {
+    AUDIO_CMD_TONE = 0,         // 提示音: param = 频率(Hz), param2 = 时长(ms)
+    AUDIO_CMD_REC_START = 1,    // 开始录音: rec = 录音对象
+    AUDIO_CMD_REC_STOP = 2,     // 停止录音: rec = 要停的录音 (NULL = 当前录音)
+    AUDIO_CMD_STREAM = 3,       // 开始播放抖动缓冲中的回复音频
+    AUDIO_CMD_EARCON = 4,       // 预置提示音序列: param = Earcon
+    AUDIO_CMD_ALERT = 5,        // 告警通道播放提示音序列: param = Earcon
+    AUDIO_CMD_GAIN = 6,         // 设置混音通道增益: param = MixVoice, param2 = 增益 (Q15)
+    AUDIO_CMD_BARGE_IN = 7,     // 打断回复并开始录音: param = 静音自动停止时长 (ms), rec = 录音对象
+    AUDIO_CMD_DMA_PROFILE = 8,  // 切换 I2S DMA 配置档: param = AudioDmaProfile (空闲时生效)
+    AUDIO_CMD_COUNT
+};
+
+// 预置提示音序列 (earcon)
+enum Earcon : uint8_t {
+    EARCON_FOCUS,       // 切换焦点
+    EARCON_CONFIRM,     // 操作成功 (上扬双音)
+    EARCON_ERROR,       // 出错 (下行双音)
+    EARCON_DONE,        // 处理完成
+    EARCON_COUNT
+};
+
+struct Recording;
+
+struct AudioMsg {
+    uint8_t type;       // AudioCmdType
+    int param;
+    int param2;
+    Recording *rec;     // 录音指令附带的录音对象
+    uint32_t post_us;   // 投递时间戳，用于统计派发延迟
+};
+
+// 每类指令的派发延迟统计 (投递 -> 引擎开始处理)
+struct AudioCmdStats {
+    uint32_t count;
+    uint32_t last_us;
+    uint32_t max_us;
+    uint64_t total_us;
+};
+
+// 音频管线统计：驱动阻塞时间、DMA 欠载 / 溢出、采集延迟、CPU 占用估算 (resetPipelineStats 起累计)
+struct AudioPipelineStats {
+    uint8_t dma_profile;
+    uint16_t dma_buf_count;
+    uint16_t dma_buf_len;
+    // 播放 (TX)
+    uint32_t tx_writes;
+    uint32_t tx_underruns;          // 回复播放中 TX DMA 被取空 (驱动补零，听感为断音)
+    uint32_t tx_blocked_max_us;     // 单次 i2s_write 最长阻塞
+    uint64_t tx_blocked_us;         // i2s_write 累计阻塞
+    uint32_t tx_clipped;            // 混音饱和 (削波) 的采样数
+    // 采集 (RX)
+    uint32_t rx_reads;
+    uint32_t rx_overruns;           // RX DMA 数据没被及时读走，被新数据覆盖 (丢帧)
+    uint32_t rx_short_reads;        // i2s_read 超时或没读满
+    uint32_t rx_backlog_reads;      // 读取时数据早已攒够 (读端落后于 DMA)
+    uint32_t rx_blocked_max_us;
+    uint64_t rx_blocked_us;
+    uint32_t dma_errors;
+    // 采集延迟：每块中最早的采样从 ADC 到处理完写进缓冲 (块长 + DMA 粒度 + 处理时间)
+    uint32_t cap_latency_last_us;
+    uint32_t cap_latency_max_us;
+    uint32_t cap_latency_avg_us;
+    // 回声消除：处理器周期计数 (录音任务固定在 Core 0，同一个计数器)，含被抢占的时间
+    uint64_t aec_cycles;
+    uint32_t aec_samples;
+    // CPU：引擎和录音任务的计算时间 (不含驱动 / 队列阻塞)，cpu_permille 为占 Core 0 的千分比
+    uint64_t engine_busy_us;
+    uint64_t rec_busy_us;
+    uint32_t elapsed_ms;
+    uint16_t cpu_permille;
+};
+
+extern QueueHandle_t AudioQueue_Handle;
+
+// 回复音频编码，由 JSON 头的 audio_format 字段指定；实际格式以 WAV 头为准
+enum ReplyCodec : uint8_t {
+    REPLY_CODEC_PCM,            // "pcm" (默认)：PCM WAV
+    REPLY_CODEC_IMA_ADPCM,      // "ima_adpcm"：IMA-ADPCM WAV，约为 PCM 的 1/4
+    REPLY_CODEC_UNSUPPORTED     // 其他 (如 "mp3")：本固件没有解码器，不播放
+};
+
+// 回复音频按块转换：每次最多取这么多输入帧，转成单声道后重采样到 I2S 采样率
+// 输入最低 4kHz，重采样后最多放大 AUDIO_SAMPLE_RATE / 4000 倍
+#define REPLY_IN_FRAMES         256
+#define REPLY_OUT_MAX           (REPLY_IN_FRAMES * AUDIO_SAMPLE_RATE / 4000 + 2)
+
+// 预录音：空闲时麦克风持续录进环形区，按下说话键时把最近这段拼到录音开头，
+// 长按判定 (800ms) 期间说出的第一个字不会丢。
+// 环形区就是一个录音段 (约 1 秒)：开始录音时整段交给录音当第一段 (不拷贝)，再从段池换一个新的
+#define PREROLL_BYTES           REC_SEGMENT_BYTES
+
+// 录音 VAD：开口前只保留 200ms，说完后只保留 300ms，其余静音不上传
+#define VAD_LEAD_PAD_MS         200
+#define VAD_TRAIL_PAD_MS        300
+#define VAD_LEAD_PAD_BYTES      (VAD_LEAD_PAD_MS * AUDIO_SAMPLE_RATE * 2 / 1000)
+#define VAD_TRAIL_PAD_BYTES     (VAD_TRAIL_PAD_MS * AUDIO_SAMPLE_RATE * 2 / 1000)
+
+// 录音分片描述 (只传偏移，不拷贝数据)，数据本体仍在分段录音缓冲中，用 getRecordSpans 取
+struct AudioChunk {
+    uint32_t offset;    // 在录音流中的起始偏移 (第一个分片包含 WAV 头)
+    uint32_t len;       // 分片长度
+    bool last;          // 是否为本次录音的最后一个分片
+};
+
+// 录音结束回调：在录音任务中调用，此时 WAV 头已回填、len 为最终长度 (含头)。
+// 回调里不要阻塞 (不要拿 GUI 锁)，只记录状态，由各自的任务稍后处理
+typedef void (*RecordDoneCallback)(Recording *rec, uint32_t len, void *ctx);
+
+// 录音对象池：一段在上传 / 等回复，一段在录，再留一段给打断
+#define REC_POOL_SIZE           3
+
+/**
+ * 一次录音 (WAV 头 + 单声道 PCM)
+ * startRecording() 从池里取出，录音任务写入，经 NetMessage.data 交给网络任务。
+ * 录音任务和接收方各持有一份引用，两边都 releaseRecording() 后段才还给段池、
+ * 对象回到录音池；上一段还在上传时下一段直接用另一个对象开录，互不覆盖。
+ */
+struct Recording {
+    RecordBuffer buf;
+    uint32_t len;                   // 已录制长度 (含 WAV 头)，只由录音任务写
+    volatile uint32_t published;    // 可上传的长度 (录音任务发布，按 REC_CHUNK_BYTES 对齐)
+    volatile bool done;             // 录音已结束，published 即最终长度
+    uint32_t consumed;              // 已交给网络任务的长度 (只在 waitChunk 中访问)
+    SemaphoreHandle_t ready;        // 发布新数据 / 录音结束时释放
+    uint8_t refs;                   // 持有者计数，以下两项在 recPoolMux 下访问
+    bool inUse;
+};
+
 class AppAudio {
 public:
     void init();
+
+    // 常驻音频引擎主循环 (在 TaskAudio 中调用，不返回)
+    void runEngine();
+
     void setVolume(uint8_t vol);
     void setMicGain(uint8_t gain);
 
     // 非阻塞播放一段提示音
     void playToneAsync(int freq, int duration_ms);
+    // 非阻塞播放一段预置提示音序列
+    void playEarcon(Earcon id);
+    // 在告警通道播放，与按键音、回复语音叠加输出
+    void playAlert(Earcon id);
+
+    // 设置混音通道音量 (0~100%，可大于 100 做增益)
+    void setVoiceGain(MixVoice voice, uint8_t percent);
+
+    // 录音控制都只投递指令，立即返回，可以在持有 GUI 锁时调用。
+    // 开始录音：返回本次的录音对象，调用方持有一份引用 (交给网络任务或 releaseRecording)；
+    // 录音池用尽时返回 NULL
+    Recording *startRecording();
+
+    // 停止录音 (rec 为空时停当前录音)；收尾完成后经回调 / waitChunk 的最后一个分片通知
+    bool stopRecording(Recording *rec = NULL);
+
+    // 注册录音结束回调 (只支持一个)
+    void setRecordCallback(RecordDoneCallback cb, void *ctx);
+
+    // 录音 VAD：enable 控制首尾静音裁剪；autoStopMs > 0 时说完后静音超过该时长自动停止录音
+    void setVad(bool enable, uint16_t autoStopMs = 0);
 
-    // 开始录音
-    void startRecording();
+    // 播放回复时允许用户开口打断 (默认开)；需要 VAD 开启才能自动结束打断后的录音
+    void setBargeIn(bool enable);
+    // 网络任务在 playStream 返回后调用：回复被打断时返回音频侧已开始的录音 (引用归调用方)，否则 NULL
+    Recording *takeBargeIn();
 
-    // 停止录音
-    void stopRecording();
+    // 麦克风前端各级开关 (MIC_DSP_HPF / MIC_DSP_NS / MIC_DSP_AGC 的组合，默认全开)
+    void setMicDsp(uint8_t stages);
+
+    // 预录音开关 (默认开)，关闭后空闲时不读麦克风
+    void setPreroll(bool enable);
+
+    // 归还一份录音引用；最后一份归还时录音段回到段池，对象回到录音池
+    void releaseRecording(Recording *rec);
+
+    // 等待录音的下一个分片 (网络任务调用)：上传落后时把已发布的部分合成一片，超时返回 false。
+    // 录音还在进行但暂时没有新数据时，每 REC_KEEPALIVE_MS 返回一个空的非最后分片
+    bool waitChunk(Recording *rec, AudioChunk *chunk, TickType_t wait);
+
+    // 录音流 [offset, offset + len) 的分散 / 聚集列表 (网络任务调用)，返回段数；
+    // 一次最多 maxSpans 段，剩余部分调用方推进 offset 后再取
+    int getRecordSpans(Recording *rec, uint32_t offset, uint32_t len, RecSpan *spans, int maxSpans);
 
     // 内部任务处理函数
-    void _playTask(void *param);
     void _recordTask(void *param);
-    void playStream(WiFiClient *client, int length);//流式播放
-    // --- 修复点：将这些变量移到 public 区域，以便外部 (UI Logic) 可以读取 ---
-    // --- 新增：录音相关变量 ---
-    uint8_t *record_buffer = NULL;       // 录音缓冲区指针
-    uint32_t record_data_len = 0;        // 当前已录制的数据长度
-    const uint32_t MAX_RECORD_SIZE = 1024 * 512; // 定义最大录音大小
+    // 流式播放回复：解析 WAV 头，任意采样率 / 声道的 PCM 转成单声道 AUDIO_SAMPLE_RATE 后送去播放；
+    // src 是去掉分帧后的回复音频，net 用于检查连接是否还在；
+    // tee 不为空时收到的原始字节同时写一份 (回复缓存)。完整收完并播完返回 true
+    bool playStream(Stream *src, WiFiClient *net, int length, ReplyCodec codec = REPLY_CODEC_PCM, Print *tee = NULL);
+    // 播放本地缓存的回复 (格式同上)
+    bool playCached(Stream *src, int length, ReplyCodec codec);
+
+    // 设置流式播放的预缓冲时长 (攒够多少毫秒的数据才开始出声)
+    void setPrebufferMs(int ms);
+    AudioRingBuffer::Stats getStreamStats();
+
+    // 指令派发延迟统计
+    AudioCmdStats getCmdStats(uint8_t type);
+    void printCmdStats();
+
+    // 音频管线统计 (任意任务可调用)
+    AudioPipelineStats getPipelineStats();
+    void resetPipelineStats();
+    void printPipelineStats();
+
+    // 切换 I2S DMA 配置档；正在播放 / 录音时推迟到空闲再生效
+    void setDmaProfile(AudioDmaProfile profile);
+
+    // 编解码器电源状态与 I2C 访问统计
+    void printCodecStats();
 
 private:
-    void writeReg(uint8_t reg, uint8_t data);
-    uint8_t readReg(uint8_t reg);
+    // 编解码器：寄存器读写都经影子缓存，电源状态由引擎按需切换
+    Es8311Codec codec;
+    uint32_t dacLastUse = 0;             // 发送端最近一次有声音的时间 (DAC 空闲掉电用)
+    uint32_t updateCodecPower();
 
     // --- 新增：WAV 头部生成辅助函数声明 ---
     void createWavHeader(uint8_t *header, uint32_t totalDataLen, uint32_t sampleRate, uint8_t sampleBits, uint8_t numChannels);
 
+    // --- 音频引擎 ---
+    bool post(uint8_t type, int param = 0, int param2 = 0, Recording *rec = NULL);
+    void dispatch(const AudioMsg &msg);
+    void mixBlock();
+    int readStream(TickType_t wait);
+    void capturePreroll();
+    void pushEchoRef(const int16_t *tx, int frames);
+    void cancelEcho(int16_t *pcm, int frames, uint32_t rxUs);
+    void detectBargeIn(const int16_t *pcm, int frames);
+    uint32_t beginUtterance(Recording *rec);
+    Recording *acquireRecording();
+    bool armRecording(Recording *rec, uint32_t autoStopMs);
+    void abortRecording(Recording *rec);
+    void dropBargeIn();
+    void feedReply(const uint8_t *data, size_t len);
+    void pushReply(const int16_t *pcm, size_t samples);
+
     const i2s_port_t i2s_num = I2S_NUM_0;
+
+    // I2S 驱动安装 / 切换 DMA 配置档 (切换只在引擎任务中进行)
+    bool installI2s(uint8_t profile);
+    void applyDmaProfile();
+    // 读麦克风 (录音任务专用)：持有 i2sRxLock，顺带记录阻塞时间和驱动事件
+    size_t readMic(void *dst, size_t bytes, uint32_t *doneUs);
+    void noteCapture(int frames, uint32_t readUs, uint32_t doneUs);
+    void pollI2sEvents();
+
+    QueueHandle_t i2sEvents = NULL;      // 驱动事件队列 (TX/RX DMA 欠载、溢出)
+    SemaphoreHandle_t i2sRxLock = NULL;  // 重装驱动时挡住录音任务的 i2s_read
+    uint8_t dmaProfile = AUDIO_DMA_DEFAULT_PROFILE;
+    volatile uint8_t pendingDmaProfile = AUDIO_DMA_DEFAULT_PROFILE;
+    uint32_t dmaQueueFrames = 0;         // 当前发送端排队深度 (count x len)，回声对齐要用
+    uint32_t dmaBufUs = 0;               // 一个 DMA 缓冲的时长
+
+    // 管线统计：TX 字段由引擎写，RX / 采集字段由录音任务写，都在 statsMux 下更新
+    AudioPipelineStats pipe = {};
+    uint64_t capLatencyTotal = 0;
+    uint32_t capLatencyCount = 0;
+    uint32_t pipeStartMs = 0;
+    volatile bool txLive = false;        // 回复已开始往 I2S 写 (此后 TX DMA 被取空才算欠载)
+    volatile bool rxLive = false;        // 录音任务正在持续读 I2S
+    portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
     
-    TaskHandle_t recordTaskHandle = NULL;
+    TaskHandle_t recordTaskHandle = NULL; // 常驻录音任务 (静态栈)，平时阻塞在任务通知上
+    RecordDoneCallback recDoneCb = NULL; // 录音任务收尾 (回填 WAV 头) 后调用
+    void *recDoneCtx = NULL;
+
+    AudioRingBuffer streamRing;          // 网络 -> 播放 的抖动缓冲
+    SemaphoreHandle_t streamDone = NULL; // 引擎放完回复后释放
     volatile bool isRecording = false;
 
+    Recording recPool[REC_POOL_SIZE];    // 录音对象池 (段按需申请，空闲对象不占 PSRAM)
+    portMUX_TYPE recPoolMux = portMUX_INITIALIZER_UNLOCKED;
+    Recording *volatile activeRec = NULL; // 录音任务正在写的录音 (引擎开始录音时设置)
+    uint8_t *prerollRing = NULL;         // 预录音环形区 (一个录音段，只在录音任务中访问)
+    bool prerollEnabled = true;
+    uint32_t prerollPos = 0;             // 环形区写位置 (只在录音任务中访问)
+    uint32_t prerollFill = 0;
+
+    // playStream / playCached 的公共部分；net 为空表示本地数据源
+    bool playSource(Stream *src, WiFiClient *net, int length, ReplyCodec codec, Print *tee);
+
+    // 回复格式转换 (只在网络任务的 playStream 中使用)
+    WavParser replyWav;
+    AdpcmStreamDecoder replyAdpcm;
+    PolyphaseResampler replyResampler;
+    uint8_t replyFrame[4];               // 跨分片的不完整帧
+    uint8_t replyCarry = 0;
+    int16_t replyIn[REPLY_IN_FRAMES];
+    int16_t replyOut[REPLY_OUT_MAX];
+
+    MicFrontEnd micDsp;                  // 隔直 / 降噪 / AGC，只在录音任务中使用
+    VoiceDetector vad;                   // 只在录音任务中使用
+    bool vadEnabled = true;
+    uint16_t vadAutoStopMs = 0;          // 0 = 不自动停止 (按键松开才停)
+    uint16_t recAutoStopMs = 0;          // 本次录音的自动停止时长 (打断录音单独设置)
+
+    // 全双工回声消除 / 打断
+    bool bargeInEnabled = true;
+    volatile bool duplexActive = false;  // 回复播放中，引擎在往参考环里写
+    volatile bool bargeIn = false;       // 打断录音已开始 (引擎置位)，网络任务 takeBargeIn() 清除
+    Recording *bargeRec = NULL;          // 打断后开始的录音，等网络任务 takeBargeIn() 接手 (recPoolMux 下访问)
+    bool bargePosted = false;            // 已发出 AUDIO_CMD_BARGE_IN、录音还没开始 (只在录音任务中使用)
+    volatile uint32_t aecSession = 0;    // 每次开始播放加一，录音任务据此重新对齐
+    int16_t aecRef[AEC_REF_RING];        // 播放参考 (引擎写，录音任务读)
+    volatile uint32_t aecTxCount = 0;    // 已写入参考环的采样总数
+    uint32_t aecStampCount = 0;          // 最近一次 i2s_write 返回时的 aecTxCount 和时间
+    uint32_t aecStampUs = 0;
+    portMUX_TYPE aecMux = portMUX_INITIALIZER_UNLOCKED;
+    EchoCanceller aec;                   // 以下只在录音任务中访问
+    VoiceDetector bargeVad;
+    uint32_t aecLocked = 0;
+    uint32_t aecRefIdx = 0;              // 下一块麦克风数据对应的参考位置
+    uint32_t duplexStartMs = 0;
+    int16_t aecRefBlock[512];
+
+    // 引擎状态 (只在 TaskAudio 中访问)
+    ToneSynth synth;                     // 定点波表合成器 (提示音 / earcon)
+    ToneSynth alertSynth;                // 告警通道合成器
+    AudioMixer mixer;                    // 多通道混音，输出唯一的 I2S 发送流
+    bool streamActive = false;
+    int streamCarry = 0;                 // 上次读取剩下的半个样本 (奇数字节)
+    uint8_t streamTail = 0;
+    int16_t streamPcm[TX_CHUNK_FRAMES];
+
+    AudioCmdStats cmdStats[AUDIO_CMD_COUNT] = {};
+
     // (原先在这里的变量已移动到 public)
 };
 
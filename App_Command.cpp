@@ -0,0 +1,190 @@
+#include "App_Command.h"
+#include <LittleFS.h>
+#include "App_IR.h"
+#include "App_433.h"
+
+AppCommand MyCommand;
+
+// 内置路由表：flash 中没有路由表时使用
+static constexpr CommandEntry builtinTable[] = {
+    // 服务器回复 control 字段 (target / action / value)
+    cmdIrNec("空调", "开", NULL, 0x11111111),
+    cmdIrNec("空调", "关", NULL, 0x22222222),
+    cmdIrNec("空调", NULL, "26", 0x33333333),
+    cmdIrNec("灯", "开", NULL, 0x44444444),
+    cmdIrNec("灯", "关", NULL, 0x55555555),
+    // 本地 AI 指令 (AirConditioner / CarDoor) 以前只打印日志，还没有真实码值，不放默认路由；
+    // 要控制时写进 flash 路由表 (tools/gen_cmd_table.py)
+};
+
+#define BUILTIN_COUNT ((int)(sizeof(builtinTable) / sizeof(builtinTable[0])))
+
+static constexpr uint32_t builtinSeed = cmdFindSeed(builtinTable, BUILTIN_COUNT);
+static_assert(BUILTIN_COUNT <= CMD_MAX_ENTRIES, "builtin command table too large");
+static_assert(builtinSeed != CMD_NO_SEED, "no collision-free seed for the builtin command table");
+static_assert(CMD_SEED_LIMIT <= 256, "displacements are stored in one byte");
+static_assert(sizeof(CommandEntry) == 32, "CommandEntry must match the flash table record");
+
+static const char *transportNames[CMD_TRANSPORT_COUNT] = { "none", "IR NEC", "IR Coolix", "433" };
+
+static uint32_t readLe32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t blobChecksum(const uint8_t *data, size_t len, uint32_t h = 2166136261u) {
+    for (size_t i = 0; i < len; i++) h = (h ^ data[i]) * 16777619u;
+    return h;
+}
+
+// 校验表头 (含位移表) 和表项，返回表项数，不合法返回 -1
+static int checkBlob(const uint8_t *hdr, const uint8_t *entries, size_t entriesLen) {
+    if (readLe32(hdr) != CMD_TABLE_MAGIC || hdr[4] != CMD_TABLE_VERSION) return -1;
+    int count = hdr[5];
+    if (count == 0 || count > CMD_MAX_ENTRIES || entriesLen != count * sizeof(CommandEntry)) return -1;
+    if (blobChecksum(entries, entriesLen, blobChecksum(hdr + 12, CMD_BUCKETS)) != readLe32(hdr + 8)) return -1;
+    for (int i = 0; i < count; i++) {
+        const CommandEntry *e = (const CommandEntry *)(entries + i * sizeof(CommandEntry));
+        if (e->target == CMD_ANY || e->transport == CMD_TRANSPORT_NONE || e->transport >= CMD_TRANSPORT_COUNT ||
+            e->len > CMD_PAYLOAD_MAX) {
+            return -1;
+        }
+    }
+    return count;
+}
+
+void AppCommand::useTable(const CommandEntry *table, int count, const uint8_t *disp, uint8_t seed, bool fromFlash) {
+    if (disp) memcpy(_disp, disp, sizeof(_disp));
+    else memset(_disp, seed, sizeof(_disp));
+    memset(_slots, -1, sizeof(_slots));
+    uint16_t probes = 0;
+    for (int i = 0; i < count; i++) {
+        const CommandEntry &e = table[i];
+        uint32_t key = cmdKey(e.target, e.action, e.value);
+        uint32_t s = cmdSlot(key, _disp[cmdBucket(key)]);
+        // 位移不完美时线性探测，装载率不超过一半，总能放下
+        while (_slots[s] >= 0) {
+            probes++;
+            s = (s + 1) & (CMD_SLOTS - 1);
+        }
+        _slots[s] = i;
+    }
+    _table = table;
+    _count = count;
+    _stats.entries = count;
+    _stats.probes = probes;
+    _stats.fromFlash = fromFlash;
+}
+
+void AppCommand::begin() {
+    useTable(builtinTable, BUILTIN_COUNT, NULL, builtinSeed, false);
+
+    File f = LittleFS.open(CMD_TABLE_PATH, "r");
+    if (f) {
+        // 表项直接读进 _loaded (当前用的是内置表)，校验通过才切换
+        uint8_t hdr[CMD_TABLE_HEADER];
+        size_t n = 0;
+        int count = -1;
+        if (f.read(hdr, sizeof(hdr)) == sizeof(hdr) && f.size() <= CMD_TABLE_HEADER + sizeof(_loaded)) {
+            n = f.read((uint8_t *)_loaded, sizeof(_loaded));
+            count = checkBlob(hdr, (const uint8_t *)_loaded, n);
+        }
+        f.close();
+        if (count > 0) {
+            useTable(_loaded, count, hdr + 12, 0, true);
+        } else {
+            Serial.println("[Cmd] " CMD_TABLE_PATH " invalid, using builtin table.");
+        }
+    }
+    Serial.printf("[Cmd] Routing table: %d entries (%s), %d probes\n", _count,
+                  _stats.fromFlash ? "flash" : "builtin", _stats.probes);
+}
+
+const CommandEntry *AppCommand::find(uint32_t target, uint32_t action, uint32_t value) {
+    uint32_t key = cmdKey(target, action, value);
+    uint32_t s = cmdSlot(key, _disp[cmdBucket(key)]);
+    while (_slots[s] >= 0) {
+        const CommandEntry *e = &_table[_slots[s]];
+        if (e->target == target && e->action == action && e->value == value) return e;
+        s = (s + 1) & (CMD_SLOTS - 1);
+    }
+    return NULL;
+}
+
+void AppCommand::execute(const CommandEntry *e) {
+    const uint8_t *p = e->payload;
+    _stats.dispatched++;
+    switch (e->transport) {
+        case CMD_TRANSPORT_IR_NEC:
+            MyIR.sendNEC(((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+            break;
+        case CMD_TRANSPORT_IR_COOLIX:
+            MyIR.sendCoolix((p[0] << 16) | (p[1] << 8) | p[2]);
+            break;
+        case CMD_TRANSPORT_RF433: {
+            uint8_t packet[CMD_PAYLOAD_MAX];
+            memcpy(packet, p, e->len);
+            My433.sendPacket(packet, e->len);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+int AppCommand::dispatch(const char *target, const char *action, const char *value) {
+    Serial.printf("[Cmd] Target: %s, Action: %s, Value: %s\n",
+                  target ? target : "NULL", action ? action : "NULL", value ? value : "NULL");
+    uint32_t t = cmdHash(target);
+    if (t == CMD_ANY || _table == NULL) {
+        Serial.println("[Cmd] Warning: command without target.");
+        _stats.unmatched++;
+        return 0;
+    }
+    uint32_t a = cmdHash(action);
+    uint32_t v = cmdHash(value);
+
+    int done = 0;
+    const CommandEntry *e = find(t, a, v);
+    if (e) {
+        execute(e);
+        done++;
+    } else {
+        // 没有完全匹配的表项：动作和值分别处理 (如 "开" + "26" 先开机再调温度)
+        if (v != CMD_ANY && (e = find(t, a, CMD_ANY)) != NULL) {
+            execute(e);
+            done++;
+        }
+        if (a != CMD_ANY && (e = find(t, CMD_ANY, v)) != NULL) {
+            execute(e);
+            done++;
+        }
+    }
+    if (done == 0) {
+        _stats.unmatched++;
+        Serial.println("[Cmd] No route for command.");
+    }
+    return done;
+}
+
+int AppCommand::dispatchJson(JsonVariant cmd, const char *targetKey) {
+    const char *target = cmd[targetKey];
+    const char *action = cmd["action"];
+    const char *value = cmd["value"];
+    char num[16];
+    if (value == NULL && cmd["value"].is<int>()) {
+        snprintf(num, sizeof(num), "%d", cmd["value"].as<int>());
+        value = num;
+    }
+    return dispatch(target, action, value);
+}
+
+void AppCommand::printStats() {
+    Serial.printf("[Cmd] %d entries (%s), %d probes, dispatched=%u, unmatched=%u\n",
+                  _stats.entries, _stats.fromFlash ? "flash" : "builtin", _stats.probes,
+                  _stats.dispatched, _stats.unmatched);
+    for (int i = 0; i < _count; i++) {
+        const CommandEntry &e = _table[i];
+        Serial.printf("[Cmd]   %08x/%08x/%08x -> %s, %d bytes\n", e.target, e.action, e.value,
+                      transportNames[e.transport], e.len);
+    }
+}
@@ -0,0 +1,167 @@
+#ifndef APP_COMMAND_H
+#define APP_COMMAND_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+/*
+ * 设备控制指令路由表：(对象, 动作, 值) -> 发送方式 + 载荷
+ *
+ * 三个字段各取 FNV-1a 哈希 (UTF-8 原样参与计算，缺省字段为 CMD_ANY)，合成一个键。
+ * 键先分到 CMD_BUCKETS 个桶，每个桶有自己的位移 (seed)，再按位移散列到 CMD_SLOTS 个槽
+ * (hash-and-displace 完美哈希)：位移选得让所有键各占一个槽，查找一次命中。
+ * 内置表所有桶用同一个 seed，在编译期搜索并 static_assert 无冲突；flash 中的表由生成工具
+ * 逐桶挑好位移，万一有冲突也只是多探测几个槽。表项只存哈希不存字符串。
+ *
+ * flash 中的路由表 (LittleFS 上的 CMD_TABLE_PATH，小端)：
+ *   0   "CMDT"
+ *   4   版本 (1 字节) = CMD_TABLE_VERSION，表项数 (1 字节)，保留 (2 字节)
+ *   8   校验 (4 字节)：位移表 + 表项区的 FNV-1a
+ *   12  位移表 (CMD_BUCKETS 字节)
+ *   44  表项 x N，每项 32 字节，布局同 CommandEntry
+ * 增加新电器只需要用 tools/gen_cmd_table.py 重新生成这个文件并上传到 LittleFS，不用重新编译固件。
+ */
+
+#define CMD_TABLE_PATH      "/cmd/table.bin"
+#define CMD_TABLE_MAGIC     0x54444D43  // "CMDT"
+#define CMD_TABLE_VERSION   1
+#define CMD_BUCKET_BITS     5
+#define CMD_BUCKETS         (1 << CMD_BUCKET_BITS)
+#define CMD_TABLE_HEADER    (12 + CMD_BUCKETS)
+
+#define CMD_MAX_ENTRIES     64
+#define CMD_SLOT_BITS       7           // 128 个槽，装载率不超过一半
+#define CMD_SLOTS           (1 << CMD_SLOT_BITS)
+#define CMD_PAYLOAD_MAX     16
+#define CMD_ANY             0u          // 通配：指令里没有这个字段
+#define CMD_SEED_LIMIT      256         // 位移 / seed 的取值范围 (1 字节)
+#define CMD_NO_SEED         0xFFFFFFFFu
+
+enum CmdTransport : uint8_t {
+    CMD_TRANSPORT_NONE      = 0,
+    CMD_TRANSPORT_IR_NEC    = 1,    // payload: 32 位码，大端
+    CMD_TRANSPORT_IR_COOLIX = 2,    // payload: 24 位码，大端 (3 字节)
+    CMD_TRANSPORT_RF433     = 3,    // payload: 原样写入 433 FIFO
+    CMD_TRANSPORT_COUNT
+};
+
+struct CommandEntry {
+    uint32_t target;        // 各字段的哈希，CMD_ANY 表示不限
+    uint32_t action;
+    uint32_t value;
+    uint8_t transport;      // CmdTransport
+    uint8_t len;            // payload 有效字节数
+    uint8_t reserved[2];
+    uint8_t payload[CMD_PAYLOAD_MAX];
+};
+
+// ---- 编译期哈希 (C++11 constexpr，只能写成单条 return 的递归) ----
+
+constexpr uint32_t cmdFnv(const char *s, uint32_t h) {
+    return *s ? cmdFnv(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+
+// 字段哈希：空字段为 CMD_ANY，真实字符串永远不为 0
+constexpr uint32_t cmdHash(const char *s) {
+    return (s == NULL || *s == 0) ? CMD_ANY : (cmdFnv(s, 2166136261u) ? cmdFnv(s, 2166136261u) : 1u);
+}
+
+constexpr uint32_t cmdRotl(uint32_t x, int r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+constexpr uint32_t cmdKey(uint32_t target, uint32_t action, uint32_t value) {
+    return target ^ cmdRotl(action, 11) ^ cmdRotl(value, 22);
+}
+
+constexpr uint32_t cmdBucket(uint32_t key) {
+    return (key * 0x85EBCA6Bu) >> (32 - CMD_BUCKET_BITS);
+}
+
+constexpr uint32_t cmdSlot(uint32_t key, uint32_t seed) {
+    return ((key ^ (seed * 0x27D4EB2Fu)) * 0x9E3779B1u) >> (32 - CMD_SLOT_BITS);
+}
+
+constexpr uint32_t cmdEntrySlot(const CommandEntry &e, uint32_t seed) {
+    return cmdSlot(cmdKey(e.target, e.action, e.value), seed);
+}
+
+// 第 i 项和前面 j 项 (0..j-1) 都不在同一个槽
+constexpr bool cmdSlotUnique(const CommandEntry *t, int i, int j, uint32_t seed) {
+    return j == 0 || (cmdEntrySlot(t[i], seed) != cmdEntrySlot(t[j - 1], seed) && cmdSlotUnique(t, i, j - 1, seed));
+}
+
+constexpr bool cmdPerfect(const CommandEntry *t, int n, uint32_t seed) {
+    return n <= 1 || (cmdSlotUnique(t, n - 1, n - 1, seed) && cmdPerfect(t, n - 1, seed));
+}
+
+constexpr uint32_t cmdFindSeed(const CommandEntry *t, int n, uint32_t seed = 0) {
+    return seed >= CMD_SEED_LIMIT ? CMD_NO_SEED : (cmdPerfect(t, n, seed) ? seed : cmdFindSeed(t, n, seed + 1));
+}
+
+// 码值按大端放进 payload 前 n 字节
+constexpr uint8_t cmdByte(uint32_t code, int n, int i) {
+    return i < n ? (uint8_t)(code >> (8 * (n - 1 - i))) : 0;
+}
+
+constexpr CommandEntry cmdEntry(const char *target, const char *action, const char *value,
+                                CmdTransport transport, uint32_t code, int n) {
+    return { cmdHash(target), cmdHash(action), cmdHash(value), (uint8_t)transport, (uint8_t)n, {0, 0},
+             { cmdByte(code, n, 0), cmdByte(code, n, 1), cmdByte(code, n, 2), cmdByte(code, n, 3) } };
+}
+
+constexpr CommandEntry cmdIrNec(const char *target, const char *action, const char *value, uint32_t code) {
+    return cmdEntry(target, action, value, CMD_TRANSPORT_IR_NEC, code, 4);
+}
+
+constexpr CommandEntry cmdIrCoolix(const char *target, const char *action, const char *value, uint32_t code) {
+    return cmdEntry(target, action, value, CMD_TRANSPORT_IR_COOLIX, code, 3);
+}
+
+constexpr CommandEntry cmdRf433(const char *target, const char *action, const char *value, uint32_t code, int n) {
+    return cmdEntry(target, action, value, CMD_TRANSPORT_RF433, code, n);
+}
+
+/**
+ * 指令路由：服务器回复里的 control 和本地 AI 指令 (handleAICommand) 共用一张表。
+ * begin() 之后表只读，不同任务同时查表不需要加锁
+ */
+class AppCommand {
+public:
+    struct Stats {
+        uint32_t dispatched;    // 执行的表项数
+        uint32_t unmatched;     // 查不到路由的指令
+        uint16_t entries;
+        uint16_t probes;        // 建索引时的冲突探测次数 (0 = 完美哈希)
+        bool fromFlash;
+    };
+
+    // 加载 flash 中的路由表 (需先挂载 LittleFS)，没有或校验失败时用内置表
+    void begin();
+
+    // 路由一条指令：先找 (对象, 动作, 值) 完全匹配，没有再分别找 (对象, 动作, *) 和 (对象, *, 值)。
+    // 返回执行的表项数
+    int dispatch(const char *target, const char *action, const char *value);
+    // JSON 指令：targetKey 为对象字段名 (服务器回复用 "target"，本地 AI 指令用 "object")；
+    // 数值型的 value 按十进制文本匹配
+    int dispatchJson(JsonVariant cmd, const char *targetKey);
+
+    void printStats();
+
+private:
+    // 建槽索引；disp 为 NULL 时所有桶用 seed
+    void useTable(const CommandEntry *table, int count, const uint8_t *disp, uint8_t seed, bool fromFlash);
+    const CommandEntry *find(uint32_t target, uint32_t action, uint32_t value);
+    void execute(const CommandEntry *e);
+
+    const CommandEntry *_table = NULL;
+    int _count = 0;
+    uint8_t _disp[CMD_BUCKETS];
+    int8_t _slots[CMD_SLOTS];
+    CommandEntry _loaded[CMD_MAX_ENTRIES];
+    Stats _stats = {};
+};
+
+extern AppCommand MyCommand;
+
+#endif
@@ -0,0 +1,234 @@
+#include "App_Es8311.h"
+
+// 通路开关序列 (取自 ES8311 数据手册和官方驱动的 start / suspend 流程)。
+// 上电：先开模拟基准，再开通路，最后解除静音；掉电倒过来，先静音再关通路
+#define REG_RESET       0x00
+#define REG_SYS_PWR     0x0D    // 模拟部分 / 基准电压
+#define REG_ADC_PWR     0x0E    // PGA、ADC 调制器
+#define REG_DAC_PWR     0x12
+#define REG_PGA         0x14    // 麦克风选择 + PGA 增益 (0 = 断开)
+#define REG_DAC_VOL     0x32
+#define REG_GP          0x45
+
+static const uint8_t analogOn[][2]  = { {REG_SYS_PWR, 0x01}, {REG_GP, 0x00} };
+static const uint8_t analogOff[][2] = { {REG_GP, 0x01}, {REG_SYS_PWR, 0xFA} };
+static const uint8_t adcOff[][2]    = { {REG_PGA, 0x00}, {REG_ADC_PWR, 0xFF} };
+static const uint8_t dacOff[][2]    = { {REG_DAC_VOL, 0x00}, {REG_DAC_PWR, 0x02} };
+
+static const char *powerNames[CODEC_POWER_COUNT] = { "OFF", "ADC", "DAC", "DUPLEX" };
+
+bool Es8311Codec::begin(TwoWire *wire, uint8_t addr, int paPin) {
+    _wire = wire;
+    _addr = addr;
+    _paPin = paPin;
+    _lock = xSemaphoreCreateMutex();
+    if (_paPin >= 0) {
+        pinMode(_paPin, OUTPUT);
+        digitalWrite(_paPin, LOW);
+    }
+    return _lock != NULL;
+}
+
+bool Es8311Codec::shadowHit(uint8_t reg, uint8_t val) const {
+    return reg < ES8311_REG_COUNT && (_valid[reg >> 3] & (1 << (reg & 7))) && _shadow[reg] == val;
+}
+
+// 一次 I2C 传输写 n 个地址连续的寄存器，成功后更新影子
+bool Es8311Codec::transfer(uint8_t reg, const uint8_t *vals, int n) {
+    _wire->beginTransmission(_addr);
+    _wire->write(reg);
+    _wire->write(vals, n);
+    bool ok = (_wire->endTransmission() == 0);
+
+    _stats.transfers++;
+    if (!ok) {
+        _stats.errors++;
+        Serial.printf("[Codec] I2C write 0x%02X (+%d) failed!\n", reg, n - 1);
+    }
+    for (int i = 0; i < n; i++) {
+        uint8_t r = reg + i;
+        if (r >= ES8311_REG_COUNT) continue;
+        if (ok) {
+            _shadow[r] = vals[i];
+            _valid[r >> 3] |= (1 << (r & 7));
+        } else {
+            _valid[r >> 3] &= ~(1 << (r & 7));     // 写没写进去不确定，下次照写
+        }
+    }
+    if (ok) _stats.regs_written += n;
+    return ok;
+}
+
+bool Es8311Codec::writeLocked(uint8_t reg, uint8_t val) {
+    if (shadowHit(reg, val)) {
+        _stats.regs_skipped++;
+        return true;
+    }
+    return transfer(reg, &val, 1);
+}
+
+int Es8311Codec::writeTableLocked(const uint8_t (*table)[2], int count) {
+    uint8_t run[ES8311_BURST_MAX];
+    int transfers = 0;
+    int i = 0;
+    while (i < count) {
+        if (shadowHit(table[i][0], table[i][1])) {
+            _stats.regs_skipped++;
+            i++;
+            continue;
+        }
+        // 往后合并：下一项地址正好加一且也需要写
+        uint8_t start = table[i][0];
+        int n = 0;
+        run[n++] = table[i][1];
+        i++;
+        while (i < count && n < ES8311_BURST_MAX &&
+               table[i][0] == (uint8_t)(start + n) && !shadowHit(table[i][0], table[i][1])) {
+            run[n++] = table[i][1];
+            i++;
+        }
+        transfer(start, run, n);
+        transfers++;
+    }
+    return transfers;
+}
+
+bool Es8311Codec::write(uint8_t reg, uint8_t val) {
+    if (_lock == NULL) return false;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    bool ok = writeLocked(reg, val);
+    xSemaphoreGive(_lock);
+    return ok;
+}
+
+int Es8311Codec::writeTable(const uint8_t (*table)[2], int count) {
+    if (_lock == NULL) return 0;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    int n = writeTableLocked(table, count);
+    xSemaphoreGive(_lock);
+    return n;
+}
+
+uint8_t Es8311Codec::read(uint8_t reg) {
+    if (_lock == NULL) return 0;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    uint8_t val = 0;
+    if (reg < ES8311_REG_COUNT && (_valid[reg >> 3] & (1 << (reg & 7)))) {
+        val = _shadow[reg];
+    } else {
+        _stats.reads++;
+        _wire->beginTransmission(_addr);
+        _wire->write(reg);
+        _wire->endTransmission(false);
+        _wire->requestFrom(_addr, (uint8_t)1);
+        if (_wire->available()) {
+            val = _wire->read();
+            if (reg < ES8311_REG_COUNT) {
+                _shadow[reg] = val;
+                _valid[reg >> 3] |= (1 << (reg & 7));
+            }
+        }
+    }
+    xSemaphoreGive(_lock);
+    return val;
+}
+
+void Es8311Codec::reset(const uint8_t (*table)[2], int count) {
+    if (_lock == NULL) return;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if (_paPin >= 0) digitalWrite(_paPin, LOW);
+
+    uint8_t v = 0x1F;
+    transfer(REG_RESET, &v, 1);
+    delay(20);
+    // 复位后芯片回到默认值，影子全部作废
+    memset(_valid, 0, sizeof(_valid));
+    v = 0x00;
+    transfer(REG_RESET, &v, 1);
+
+    uint32_t before = _stats.transfers;
+    writeTableLocked(table, count);
+    _power = CODEC_POWER_DUPLEX;
+    if (_paPin >= 0) digitalWrite(_paPin, HIGH);
+    Serial.printf("[Codec] Init: %d regs in %d transfers\n", count, _stats.transfers - before);
+    xSemaphoreGive(_lock);
+}
+
+void Es8311Codec::setDacVolume(uint8_t regVal) {
+    if (_lock == NULL) return;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _dacVolume = regVal;
+    if (CODEC_POWER_HAS_DAC(_power)) writeLocked(REG_DAC_VOL, regVal);
+    xSemaphoreGive(_lock);
+}
+
+void Es8311Codec::setMicGain(uint8_t regVal) {
+    if (_lock == NULL) return;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _micGain = regVal;
+    if (CODEC_POWER_HAS_ADC(_power)) writeLocked(REG_PGA, regVal);
+    xSemaphoreGive(_lock);
+}
+
+uint32_t Es8311Codec::setPower(CodecPower target) {
+    if (_lock == NULL || target >= CODEC_POWER_COUNT) return 0;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    CodecPower from = _power;
+    if (target == from) {
+        xSemaphoreGive(_lock);
+        return 0;
+    }
+
+    uint32_t t0 = (uint32_t)micros();
+    uint32_t regs = _stats.regs_written;
+    uint32_t xfers = _stats.transfers;
+    bool adc = CODEC_POWER_HAS_ADC(target);
+    bool dac = CODEC_POWER_HAS_DAC(target);
+
+    // 先关：功放最先关，避免 DAC 掉电时的爆音
+    if (!dac && CODEC_POWER_HAS_DAC(from)) {
+        if (_paPin >= 0) digitalWrite(_paPin, LOW);
+        writeTableLocked(dacOff, 2);
+    }
+    if (!adc && CODEC_POWER_HAS_ADC(from)) writeTableLocked(adcOff, 2);
+    if (target == CODEC_POWER_OFF) writeTableLocked(analogOff, 2);
+
+    // 再开：用户音量 / 增益在这里恢复
+    if (from == CODEC_POWER_OFF) writeTableLocked(analogOn, 2);
+    if (adc && !CODEC_POWER_HAS_ADC(from)) {
+        const uint8_t on[][2] = { {REG_ADC_PWR, 0x02}, {REG_PGA, _micGain} };
+        writeTableLocked(on, 2);
+    }
+    if (dac && !CODEC_POWER_HAS_DAC(from)) {
+        const uint8_t on[][2] = { {REG_DAC_PWR, 0x00}, {REG_DAC_VOL, _dacVolume} };
+        writeTableLocked(on, 2);
+        if (_paPin >= 0) digitalWrite(_paPin, HIGH);
+    }
+
+    _power = target;
+    uint32_t us = (uint32_t)micros() - t0;
+    _stats.power_changes++;
+    _stats.last_change_us = us;
+    if (from == CODEC_POWER_OFF && us > _stats.max_resume_us) _stats.max_resume_us = us;
+    Serial.printf("[Codec] %s -> %s: %d regs / %d transfers, %u us\n", powerNames[from], powerNames[target],
+                  _stats.regs_written - regs, _stats.transfers - xfers, us);
+    xSemaphoreGive(_lock);
+    return us;
+}
+
+CodecStats Es8311Codec::getStats() {
+    CodecStats s = {};
+    if (_lock == NULL) return s;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    s = _stats;
+    xSemaphoreGive(_lock);
+    return s;
+}
+
+void Es8311Codec::printStats() {
+    CodecStats s = getStats();
+    Serial.printf("[Codec] Power %s, changes=%u (last %u us, max resume %u us)\n",
+                  powerNames[_power], s.power_changes, s.last_change_us, s.max_resume_us);
+    Serial.printf("[Codec] I2C transfers=%u regs=%u skipped=%u reads=%u errors=%u\n",
+                  s.transfers, s.regs_written, s.regs_skipped, s.reads, s.errors);
+}
@@ -0,0 +1,90 @@
+#ifndef APP_ES8311_H
+#define APP_ES8311_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// 影子寄存器覆盖 0x00 ~ 0x4F (ES8311 的寄存器都在这个范围内)
+#define ES8311_REG_COUNT    0x50
+// 芯片写入时寄存器地址自动加一：地址连续的寄存器合并成一次 I2C 传输，一次最多这么多个
+#define ES8311_BURST_MAX    16
+
+// 播放通路空闲多久后掉电 (提示音、回复之间的短间隙不反复开关功放，避免爆音)
+#define CODEC_DAC_HANG_MS   3000
+
+// 编解码器电源状态
+enum CodecPower : uint8_t {
+    CODEC_POWER_OFF = 0,    // 模拟部分、ADC、DAC 全部掉电，功放关闭
+    CODEC_POWER_ADC,        // 只开录音通路
+    CODEC_POWER_DAC,        // 只开播放通路和功放
+    CODEC_POWER_DUPLEX,     // 全开
+    CODEC_POWER_COUNT
+};
+
+#define CODEC_POWER_HAS_ADC(p)  ((p) == CODEC_POWER_ADC || (p) == CODEC_POWER_DUPLEX)
+#define CODEC_POWER_HAS_DAC(p)  ((p) == CODEC_POWER_DAC || (p) == CODEC_POWER_DUPLEX)
+
+// I2C 访问统计
+struct CodecStats {
+    uint32_t transfers;         // 实际发起的写传输次数
+    uint32_t regs_written;      // 实际写入的寄存器个数
+    uint32_t regs_skipped;      // 与影子相同而跳过的写入
+    uint32_t reads;             // 读硬件的次数 (影子命中不算)
+    uint32_t errors;            // endTransmission 失败次数
+    uint32_t power_changes;
+    uint32_t last_change_us;    // 最近一次切换电源状态的耗时
+    uint32_t max_resume_us;     // 从掉电恢复 (OFF -> 任意) 的最长耗时
+};
+
+/**
+ * ES8311 寄存器访问 + 电源状态管理
+ * 所有写入先和影子比对，值没变就不发 I2C；成组写入时地址连续的寄存器合并成一次传输。
+ * 电源状态只改通路开关相关的几个寄存器，其余配置 (时钟、格式、增益) 掉电期间保留在芯片里，
+ * 恢复时也只写和影子不同的部分。各任务都可以调用 (内部加锁)。
+ */
+class Es8311Codec {
+public:
+    bool begin(TwoWire *wire, uint8_t addr, int paPin);
+
+    // 软复位后写入初始化表 (复位后影子全部作废，整表写一遍)，结束时处于 DUPLEX
+    void reset(const uint8_t (*table)[2], int count);
+
+    // 单个寄存器，值与影子相同时跳过
+    bool write(uint8_t reg, uint8_t val);
+    // 成组写入：跳过与影子相同的项，表中相邻且地址连续的项合并成一次传输；返回传输次数
+    int writeTable(const uint8_t (*table)[2], int count);
+    // 有效的影子直接返回，否则读硬件并更新影子
+    uint8_t read(uint8_t reg);
+
+    // 播放音量 (REG32) / 麦克风 PGA (REG14)：通路掉电时只记下，上电时写入
+    void setDacVolume(uint8_t regVal);
+    void setMicGain(uint8_t regVal);
+
+    // 切换电源状态，返回耗时 (us)；状态不变时不访问总线
+    uint32_t setPower(CodecPower target);
+    CodecPower power() const { return _power; }
+
+    CodecStats getStats();
+    void printStats();
+
+private:
+    bool writeLocked(uint8_t reg, uint8_t val);
+    int writeTableLocked(const uint8_t (*table)[2], int count);
+    bool transfer(uint8_t reg, const uint8_t *vals, int n);
+    bool shadowHit(uint8_t reg, uint8_t val) const;
+
+    TwoWire *_wire = NULL;
+    uint8_t _addr = 0;
+    int _paPin = -1;
+    SemaphoreHandle_t _lock = NULL;
+
+    uint8_t _shadow[ES8311_REG_COUNT] = {};
+    uint8_t _valid[ES8311_REG_COUNT / 8] = {};      // 每位对应一个寄存器的影子是否可信
+
+    CodecPower _power = CODEC_POWER_OFF;
+    uint8_t _dacVolume = 0xBF;
+    uint8_t _micGain = 0x1A;
+    CodecStats _stats = {};
+};
+
+#endif
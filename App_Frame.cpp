@@ -0,0 +1,56 @@
+#include "App_Frame.h"
+
+void FrameEncoder::putU32(uint8_t *out, uint32_t v) {
+    out[0] = (uint8_t)(v >> 24);
+    out[1] = (uint8_t)(v >> 16);
+    out[2] = (uint8_t)(v >> 8);
+    out[3] = (uint8_t)v;
+}
+
+uint32_t FrameEncoder::getU32(const uint8_t *in) {
+    return ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 8) | in[3];
+}
+
+void FrameEncoder::encodeHeader(uint8_t *out, uint8_t type, uint16_t txn, uint32_t len, uint8_t flags) {
+    out[0] = type;
+    out[1] = flags;
+    out[2] = (uint8_t)(txn >> 8);
+    out[3] = (uint8_t)txn;
+    putU32(out + 4, len);
+}
+
+void FrameDecoder::reset() {
+    _state = STATE_HEADER;
+    _fill = 0;
+    _left = 0;
+}
+
+size_t FrameDecoder::feed(const uint8_t *data, size_t len) {
+    if (_state != STATE_HEADER) return 0;
+
+    size_t n = FRAME_HEADER_LEN - _fill;
+    if (n > len) n = len;
+    memcpy(_buf + _fill, data, n);
+    _fill += n;
+    if (_fill < FRAME_HEADER_LEN) return n;
+
+    _hdr.type = _buf[0];
+    _hdr.flags = _buf[1];
+    _hdr.txn = (_buf[2] << 8) | _buf[3];
+    _hdr.len = FrameEncoder::getU32(_buf + 4);
+    _fill = 0;
+    if (_hdr.len > FRAME_MAX_PAYLOAD) {
+        _state = STATE_FAILED;
+        return n;
+    }
+    _left = _hdr.len;
+    _state = STATE_PAYLOAD;
+    return n;
+}
+
+void FrameDecoder::consume(uint32_t n) {
+    if (_state != STATE_PAYLOAD) return;
+    _left = (n >= _left) ? 0 : _left - n;
+    // 空 payload 的帧也要经过一次 consume(0) 才算处理完
+    if (_left == 0) _state = STATE_HEADER;
+}
@@ -0,0 +1,97 @@
+#ifndef APP_FRAME_H
+#define APP_FRAME_H
+
+#include <Arduino.h>
+
+/*
+ * 与 AI 服务器之间的分帧协议 (双向同一种帧格式，整数一律大端)
+ *
+ *   帧头 8 字节: type(1) flags(1) txn(2) len(4)，后跟 len 字节 payload
+ *
+ * 连接建立后双方先交换 HELLO (txn 0)，payload = 协议版本(1) + 能力位(4)；版本不一致时设备断开。
+ * 一次对话 (txn 递增)：
+ *   设备 -> AUDIO x N, AUDIO_END              录音分片 (WAV / ADPCM WAV 字节流，任意切分)
+ *   服务 -> JSON                               回复 JSON
+ *   设备 -> CACHE (1 字节 HIT/MISS)            仅当 JSON 带 audio_id
+ *   服务 -> REPLY_START (4 字节总长，0 = 无音频), REPLY_AUDIO x N, REPLY_END
+ * 设备可随时发 CANCEL (如用户打断回复)，服务器停止发送并以 REPLY_END 结束本事务。
+ * 其他事务：PING -> PONG；设备上报 JSON (控制回执 / 遥测) -> ACK。
+ * 服务器出错时发 ERROR (错误码 2 字节 + 文本) 结束事务。
+ */
+
+#define FRAME_PROTOCOL_VERSION  1
+#define FRAME_HEADER_LEN        8
+#define FRAME_MAX_PAYLOAD       (256 * 1024)    // 超过视为流已损坏
+#define FRAME_TX_CHUNK          1024            // 设备发出的单帧 payload 上限 (帧头和数据一次写出)
+
+enum FrameType : uint8_t {
+    FRAME_HELLO         = 0x01,
+    FRAME_PING          = 0x02,
+    FRAME_PONG          = 0x03,
+    FRAME_AUDIO         = 0x10,     // 上行录音分片
+    FRAME_AUDIO_END     = 0x11,     // 一句话结束
+    FRAME_CANCEL        = 0x12,     // 放弃当前事务
+    FRAME_JSON          = 0x20,     // JSON：服务器回复 / 设备上报
+    FRAME_CACHE         = 0x21,     // 回复缓存查询结果
+    FRAME_REPLY_START   = 0x22,     // 回复音频总长
+    FRAME_REPLY_AUDIO   = 0x23,     // 回复音频分片
+    FRAME_REPLY_END     = 0x24,     // 事务应答结束
+    FRAME_ACK           = 0x25,     // 上报已收到
+    FRAME_ERROR         = 0x7F,
+};
+
+// 能力位 (HELLO 中交换，双方都支持才启用)
+#define FRAME_CAP_ADPCM_UPLOAD  0x00000001  // 上行 IMA-ADPCM
+#define FRAME_CAP_ADPCM_REPLY   0x00000002  // 下行 IMA-ADPCM
+#define FRAME_CAP_REPLY_CACHE   0x00000004  // audio_id + CACHE 应答
+#define FRAME_CAP_CANCEL        0x00000008  // CANCEL 后以 REPLY_END 收尾 (不支持时只能断开连接)
+
+struct FrameHeader {
+    uint8_t type;
+    uint8_t flags;
+    uint16_t txn;
+    uint32_t len;
+};
+
+/**
+ * 帧编码：只负责帧头，payload 由调用方紧跟着写出
+ */
+class FrameEncoder {
+public:
+    static void encodeHeader(uint8_t *out, uint8_t type, uint16_t txn, uint32_t len, uint8_t flags = 0);
+    static void putU32(uint8_t *out, uint32_t v);
+    static uint32_t getU32(const uint8_t *in);
+};
+
+/**
+ * 增量帧解码：收到多少字节就喂多少，帧头可以跨多次读取。
+ * 解析出帧头后停下 (hasHeader)，payload 由调用方直接从数据源读走并用 consume() 记账，
+ * payload 读完自动回到等帧头状态。不依赖网络，PC 上可以单独测试。
+ */
+class FrameDecoder {
+public:
+    void reset();
+
+    // 喂入数据，返回消费的字节数 (解析出帧头或 payload 未读完时不再消费)
+    size_t feed(const uint8_t *data, size_t len);
+    // 当前帧 payload 中有 n 字节已被调用方读走
+    void consume(uint32_t n);
+
+    bool hasHeader() const { return _state == STATE_PAYLOAD; }
+    const FrameHeader &header() const { return _hdr; }
+    uint32_t payloadLeft() const { return _left; }
+    // 还需要多少字节才能凑齐帧头
+    size_t headerNeeded() const { return FRAME_HEADER_LEN - _fill; }
+    // 帧头非法 (长度超限)，流已经没法继续解析
+    bool failed() const { return _state == STATE_FAILED; }
+
+private:
+    enum State : uint8_t { STATE_HEADER, STATE_PAYLOAD, STATE_FAILED };
+    State _state = STATE_HEADER;
+    uint8_t _buf[FRAME_HEADER_LEN];
+    uint8_t _fill = 0;
+    uint32_t _left = 0;
+    FrameHeader _hdr = {};
+};
+
+#endif
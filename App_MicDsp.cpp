@@ -0,0 +1,265 @@
+#include "App_MicDsp.h"
+#include <math.h>
+
+// 隔直高通极点 0.995 (16kHz 下截止约 13Hz)
+#define HPF_POLE_Q15        32604
+
+// 谱减：过减因子 2 (噪声功率 x2)，增益下限 0.1 (-20dB)，保留少量底噪以减轻音乐噪声
+#define NS_OVERSUB_SHIFT    1
+#define NS_GAIN_FLOOR       3277
+// 噪声估计：功率低于 4 倍估计值的频点视为噪声，按 1/16 跟踪均值；
+// 更高的视为语音，估计值只缓慢上爬 (每帧 1/512，约 3 秒翻倍)，噪声环境变大时也能跟上
+#define NS_SPEECH_SHIFT     2
+#define NS_TRACK_SHIFT      4
+#define NS_CREEP_SHIFT      9
+// 开头这么多帧直接平均作为初始噪声 (约 64ms)
+#define NS_INIT_FRAMES      8
+// FFT 前把整帧归一化到这个峰值，给 256 点累加留足余量
+#define NS_NORM_BITS        13
+
+// AGC：目标电平 RMS 3000 (约 -21dBFS)，增益范围 -12dB ~ +18dB
+#define AGC_TARGET_RMS      3000
+#define AGC_MAX_GAIN        (4096 * 8)
+#define AGC_MIN_GAIN        (4096 / 4)
+// 低于这个电平、或不到底噪 3 倍 (约 10dB) 的帧视为静音，保持增益不变，不去放大底噪
+#define AGC_GATE_RMS        150
+#define AGC_GATE_RATIO      3
+// 峰值不超过 28000 (约 -1.4dBFS)，限幅优先于目标电平
+#define AGC_PEAK_LIMIT      28000
+
+static uint32_t isqrt64(uint64_t v) {
+    uint64_t r = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)r;
+}
+
+static inline int16_t sat16(int32_t v) {
+    if (v > 32767) return 32767;
+    if (v < -32768) return -32768;
+    return (int16_t)v;
+}
+
+void MicFrontEnd::begin(uint32_t sampleRate) {
+    _rate = sampleRate;
+    _agcLen = sampleRate * MIC_AGC_FRAME_MS / 1000;
+
+    // 表只在这里生成一次，运行时全是整数运算
+    for (int i = 0; i < MIC_NS_FFT; i++) {
+        float w = 0.5f - 0.5f * cosf(2.0f * PI * i / MIC_NS_FFT);
+        _win[i] = (int16_t)lrintf(sqrtf(w) * 32767.0f);
+    }
+    for (int i = 0; i < MIC_NS_FFT / 2; i++) {
+        _cos[i] = (int16_t)lrintf(cosf(2.0f * PI * i / MIC_NS_FFT) * 32767.0f);
+        _sin[i] = (int16_t)lrintf(sinf(2.0f * PI * i / MIC_NS_FFT) * 32767.0f);
+    }
+    reset();
+}
+
+void MicFrontEnd::reset() {
+    _x1 = 0;
+    _y1 = 0;
+    memset(_in, 0, sizeof(_in));
+    memset(_out, 0, sizeof(_out));
+    memset(_ola, 0, sizeof(_ola));
+    memset(_noise, 0, sizeof(_noise));
+    for (int k = 0; k < MIC_NS_BINS; k++) _gainNs[k] = 32767;
+    _hopPos = 0;
+    _nsFrames = 0;
+    _agcPos = 0;
+    _agcEnergy = 0;
+    _agcPeak = 0;
+    _gain = _target = 4096;
+    _gainStep = 0;
+    _agcFloor = AGC_GATE_RMS << 8;
+}
+
+void MicFrontEnd::process(int16_t *pcm, int samples) {
+    for (int i = 0; i < samples; i++) {
+        int32_t x = pcm[i];
+
+        if (_stages & MIC_DSP_HPF) {
+            int32_t y = ((x - _x1) << 12) + (int32_t)(((int64_t)_y1 * HPF_POLE_Q15) >> 15);
+            _x1 = x;
+            _y1 = y;
+            x = sat16(y >> 12);
+        }
+
+        if (_stages & MIC_DSP_NS) {
+            // 吐出上一跳的结果，同时收集新输入；凑满一跳做一次 FFT
+            _in[MIC_NS_HOP + _hopPos] = (int16_t)x;
+            x = _out[_hopPos];
+            if (++_hopPos == MIC_NS_HOP) {
+                nsHop();
+                _hopPos = 0;
+            }
+        }
+
+        if (_stages & MIC_DSP_AGC) {
+            _agcEnergy += (uint32_t)(x * x);
+            int32_t ax = x < 0 ? -x : x;
+            if (ax > _agcPeak) _agcPeak = ax;
+
+            x = (x * _gain) >> 12;
+            if (_gain != _target) {
+                _gain += _gainStep;
+                if ((_gainStep > 0 && _gain > _target) || (_gainStep < 0 && _gain < _target)) _gain = _target;
+            }
+            if (++_agcPos == _agcLen) agcFrame();
+        }
+
+        pcm[i] = sat16(x);
+    }
+}
+
+// 原位基 2 FFT (时间抽取)，数据为 int32，乘旋转因子用 64 位积
+void MicFrontEnd::fft(int32_t *re, int32_t *im) {
+    const int n = MIC_NS_FFT;
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            int32_t t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+    for (int len = 2; len <= n; len <<= 1) {
+        int half = len >> 1;
+        int step = n / len;
+        for (int i = 0; i < n; i += len) {
+            for (int k = 0; k < half; k++) {
+                int32_t wr = _cos[k * step];
+                int32_t wi = -_sin[k * step];
+                int a = i + k, b = a + half;
+                int32_t tr = (int32_t)(((int64_t)re[b] * wr - (int64_t)im[b] * wi) >> 15);
+                int32_t ti = (int32_t)(((int64_t)re[b] * wi + (int64_t)im[b] * wr) >> 15);
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+// 处理一跳：加窗 -> FFT -> 按频点谱减 -> IFFT -> 加窗 -> 重叠相加
+void MicFrontEnd::nsHop() {
+    // 块浮点：整帧左移到峰值约 2^13，安静段也保留足够精度
+    int32_t peak = 1;
+    for (int i = 0; i < MIC_NS_FFT; i++) {
+        int32_t v = (_in[i] * _win[i]) >> 15;
+        _re[i] = v;
+        _im[i] = 0;
+        if (v < 0) v = -v;
+        if (v > peak) peak = v;
+    }
+    int shift = 0;
+    while ((peak << (shift + 1)) < (1 << NS_NORM_BITS)) shift++;
+    for (int i = 0; i < MIC_NS_FFT; i++) _re[i] <<= shift;
+
+    fft(_re, _im);
+
+    bool init = _nsFrames < NS_INIT_FRAMES;
+    for (int k = 0; k < MIC_NS_BINS; k++) {
+        uint64_t p = (uint64_t)((int64_t)_re[k] * _re[k] + (int64_t)_im[k] * _im[k]);
+        uint64_t pAbs = p >> (2 * shift);
+
+        // 噪声估计 (绝对刻度)
+        uint64_t &nz = _noise[k];
+        if (init) {
+            nz += pAbs / NS_INIT_FRAMES;
+        } else if (pAbs < (nz << NS_SPEECH_SHIFT)) {
+            if (pAbs < nz) nz -= (nz - pAbs) >> NS_TRACK_SHIFT;
+            else nz += (pAbs - nz) >> NS_TRACK_SHIFT;
+        } else {
+            nz += (nz >> NS_CREEP_SHIFT) + 1;
+        }
+
+        // 增益 = (P - 2N) / P，比较在归一化刻度下进行
+        // 噪声远大于本帧 (刻度换算会溢出) 时直接按全是噪声处理
+        bool overflow = nz > (UINT64_MAX >> (2 * shift + NS_OVERSUB_SHIFT + 1));
+        uint64_t sub = overflow ? 0 : (nz << NS_OVERSUB_SHIFT) << (2 * shift);
+        uint32_t g;
+        if (init) {
+            g = 32767;
+        } else if (overflow || sub >= p) {
+            g = NS_GAIN_FLOOR;
+        } else {
+            uint64_t num = p - sub, den = p;
+            while (den >> 32) { num >>= 1; den >>= 1; }
+            g = (den >> 15) ? (uint32_t)num / (uint32_t)(den >> 15) : 32767;
+            if (g > 32767) g = 32767;
+            if (g < NS_GAIN_FLOOR) g = NS_GAIN_FLOOR;
+        }
+        // 增益上升立即生效，下降按一半平滑，减轻音乐噪声
+        if (g < _gainNs[k]) g = (g + _gainNs[k]) >> 1;
+        _gainNs[k] = (uint16_t)g;
+
+        _re[k] = (int32_t)(((int64_t)_re[k] * g) >> 15);
+        _im[k] = (int32_t)(((int64_t)_im[k] * g) >> 15);
+        // 实信号频谱共轭对称
+        if (k > 0 && k < MIC_NS_FFT / 2) {
+            _re[MIC_NS_FFT - k] = _re[k];
+            _im[MIC_NS_FFT - k] = -_im[k];
+        }
+    }
+    if (init) _nsFrames++;
+
+    // IFFT = 共轭 -> FFT -> 共轭 / N；虚部结果不需要
+    for (int i = 0; i < MIC_NS_FFT; i++) _im[i] = -_im[i];
+    fft(_re, _im);
+
+    for (int i = 0; i < MIC_NS_FFT; i++) {
+        int32_t v = (_re[i] >> MIC_NS_FFT_BITS) >> shift;
+        _re[i] = (v * _win[i]) >> 15;
+    }
+    for (int i = 0; i < MIC_NS_HOP; i++) {
+        _out[i] = sat16(_ola[i] + _re[i]);
+        _ola[i] = _re[MIC_NS_HOP + i];
+    }
+
+    // 本跳的新输入变成下一帧的前半
+    memcpy(_in, _in + MIC_NS_HOP, MIC_NS_HOP * sizeof(int16_t));
+}
+
+// 一个 AGC 帧结束：按 RMS 算目标增益，峰值限幅优先；增益下降快、上升慢
+void MicFrontEnd::agcFrame() {
+    uint32_t rms = isqrt64(_agcEnergy / _agcLen);
+    int32_t target = _target;
+
+    // 底噪跟踪 (Q8)：下降立即跟随，上升很慢 (每帧 1/512，约 5 秒)，持续的元音不会被当成底噪
+    uint32_t rmsQ8 = rms << 8;
+    if (rmsQ8 < _agcFloor) _agcFloor = rmsQ8;
+    else _agcFloor += (rmsQ8 - _agcFloor) >> 9;
+
+    if (rms >= AGC_GATE_RMS && rmsQ8 >= _agcFloor * AGC_GATE_RATIO) {
+        target = (int32_t)((int64_t)AGC_TARGET_RMS * 4096 / rms);
+        if (_agcPeak > 0) {
+            int32_t limit = (int32_t)((int64_t)AGC_PEAK_LIMIT * 4096 / _agcPeak);
+            if (target > limit) target = limit;
+        }
+        // 上升每帧最多 +3% (约 +2.5dB / 100ms)
+        int32_t rise = _target + (_target >> 5);
+        if (target > rise) target = rise;
+        if (target > AGC_MAX_GAIN) target = AGC_MAX_GAIN;
+        if (target < AGC_MIN_GAIN) target = AGC_MIN_GAIN;
+    }
+
+    _target = target;
+    _gainStep = (_target - _gain) / _agcLen;
+    if (_gainStep == 0 && _target != _gain) _gainStep = (_target > _gain) ? 1 : -1;
+
+    _agcPos = 0;
+    _agcEnergy = 0;
+    _agcPeak = 0;
+}
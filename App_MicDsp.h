@@ -0,0 +1,77 @@
+#ifndef APP_MIC_DSP_H
+#define APP_MIC_DSP_H
+
+#include <Arduino.h>
+
+// 降噪：256 点 FFT，50% 重叠 (每 128 采样 = 8ms 处理一帧)，输出固定延迟 256 采样 (16ms)
+#define MIC_NS_FFT_BITS     8
+#define MIC_NS_FFT          (1 << MIC_NS_FFT_BITS)
+#define MIC_NS_HOP          (MIC_NS_FFT / 2)
+#define MIC_NS_BINS         (MIC_NS_FFT / 2 + 1)
+
+// AGC 按 10ms 一帧估计电平
+#define MIC_AGC_FRAME_MS    10
+
+// 各级开关，可按 CPU 预算单独关闭
+#define MIC_DSP_HPF         0x01
+#define MIC_DSP_NS          0x02
+#define MIC_DSP_AGC         0x04
+#define MIC_DSP_ALL         (MIC_DSP_HPF | MIC_DSP_NS | MIC_DSP_AGC)
+
+/**
+ * 麦克风定点前端：隔直高通 -> 谱减降噪 -> 自动增益
+ * 在录音任务中对每个采集块原地处理，块长任意；每 128 采样固定做一次 FFT/IFFT，
+ * 运算量与输入内容无关 (不会因为噪声大或说话而变慢)。
+ */
+class MicFrontEnd {
+public:
+    void begin(uint32_t sampleRate);
+    void reset();
+
+    void setStages(uint8_t stages) { _stages = stages; }
+    uint8_t stages() const { return _stages; }
+
+    // 原地处理 samples 个采样
+    void process(int16_t *pcm, int samples);
+
+    // 调试用：当前 AGC 增益 (Q12，4096 = 0dB)
+    int32_t agcGain() const { return _gain; }
+
+private:
+    void nsHop();
+    void fft(int32_t *re, int32_t *im);
+    void agcFrame();
+
+    uint32_t _rate = 16000;
+    uint8_t _stages = MIC_DSP_ALL;
+
+    // 隔直高通 (一阶)：y = x - x1 + a*y1
+    int32_t _x1 = 0;
+    int32_t _y1 = 0;            // Q12 状态，保留小数部分
+
+    // 谱减降噪
+    int16_t _win[MIC_NS_FFT];           // sqrt-Hann，Q15，分析 / 合成共用
+    int16_t _cos[MIC_NS_FFT / 2];       // 旋转因子 Q15
+    int16_t _sin[MIC_NS_FFT / 2];
+    int16_t _in[MIC_NS_FFT];            // 最近一帧输入 (前半是上一跳)
+    int16_t _out[MIC_NS_HOP];           // 上一跳的输出，逐采样吐出
+    int32_t _ola[MIC_NS_HOP];           // 重叠相加的后半帧
+    int32_t _re[MIC_NS_FFT];
+    int32_t _im[MIC_NS_FFT];
+    uint64_t _noise[MIC_NS_BINS];       // 每个频点的噪声功率估计 (绝对刻度)
+    uint16_t _gainNs[MIC_NS_BINS];      // 上一帧的谱减增益 Q15，用于平滑
+    uint16_t _hopPos = 0;
+    uint16_t _nsFrames = 0;
+
+    // AGC
+    uint16_t _agcLen = 160;
+    uint16_t _agcPos = 0;
+    uint64_t _agcEnergy = 0;
+    int32_t _agcPeak = 0;
+    uint32_t _agcFloor = 0;             // 帧 RMS 的底噪估计 (Q8)
+    int32_t _gain = 4096;               // 当前增益 Q12
+    int32_t _target = 4096;             // 目标增益 Q12
+    int32_t _gainStep = 0;              // 每采样的增益斜坡，避免拉链噪声
+};
+
+#endif
@@ -0,0 +1,65 @@
+#include "App_Mixer.h"
+
+AudioMixer::AudioMixer() {
+    for (int i = 0; i < MIX_VOICE_COUNT; i++) _gain[i] = MIX_GAIN_UNITY;
+}
+
+void AudioMixer::setGain(uint8_t voice, int32_t gain) {
+    if (voice >= MIX_VOICE_COUNT) return;
+    if (gain < 0) gain = 0;
+    _gain[voice] = gain;
+}
+
+int32_t AudioMixer::getGain(uint8_t voice) const {
+    return (voice < MIX_VOICE_COUNT) ? _gain[voice] : 0;
+}
+
+void AudioMixer::begin() {
+    _frames = 0;
+}
+
+void AudioMixer::mix(uint8_t voice, const int16_t *in, int frames) {
+    if (voice >= MIX_VOICE_COUNT || frames <= 0) return;
+    if (frames > MIXER_BLOCK_FRAMES) frames = MIXER_BLOCK_FRAMES;
+
+    // 新输入比当前块长：超出部分的累加器先清零 (懒清零，省掉每块的 memset)
+    if (frames > _frames) {
+        memset(_acc + _frames, 0, (frames - _frames) * sizeof(int32_t));
+        _frames = frames;
+    }
+
+    int32_t gain = _gain[voice];
+    if (gain == MIX_GAIN_UNITY) {
+        for (int i = 0; i < frames; i++) _acc[i] += in[i];
+    } else if (gain != 0) {
+        for (int i = 0; i < frames; i++) _acc[i] += (in[i] * gain) >> 15;
+    }
+}
+
+int AudioMixer::output(int16_t *stereo) {
+    uint32_t *dst = (uint32_t *)stereo;
+    uint32_t clipped = 0;
+
+    for (int i = 0; i < _frames; i++) {
+        int32_t v = _acc[i];
+        if (v > 32767) { v = 32767; clipped++; }
+        else if (v < -32768) { v = -32768; clipped++; }
+        uint32_t s = (uint16_t)v;
+        dst[i] = s | (s << 16);
+    }
+    _clipped += clipped;
+    return _frames;
+}
+
+int AudioMixer::outputMono(int16_t *mono) {
+    uint32_t clipped = 0;
+
+    for (int i = 0; i < _frames; i++) {
+        int32_t v = _acc[i];
+        if (v > 32767) { v = 32767; clipped++; }
+        else if (v < -32768) { v = -32768; clipped++; }
+        mono[i] = (int16_t)v;
+    }
+    _clipped += clipped;
+    return _frames;
+}
@@ -0,0 +1,56 @@
+#ifndef APP_MIXER_H
+#define APP_MIXER_H
+
+#include <Arduino.h>
+
+// 每个混音块的最大帧数 (与音频引擎的 I2S 发送块一致)
+#define MIXER_BLOCK_FRAMES  256
+
+// 混音输入通道
+enum MixVoice : uint8_t {
+    MIX_VOICE_STREAM,   // 服务器回复语音
+    MIX_VOICE_EARCON,   // 按键 / 交互提示音
+    MIX_VOICE_ALERT,    // 告警提示音 (独立通道，不会被按键音打断)
+    MIX_VOICE_COUNT
+};
+
+// 单位增益 (Q15，32768 = 1.0)
+#define MIX_GAIN_UNITY      32768
+
+/**
+ * 定点混音器
+ * 每个块：begin() -> 若干次 mix() -> output()，
+ * 各通道按增益累加到 32 位累加器，输出时饱和到 16 位并交织为立体声 (L=R)。
+ */
+class AudioMixer {
+public:
+    AudioMixer();
+
+    void setGain(uint8_t voice, int32_t gain);
+    int32_t getGain(uint8_t voice) const;
+
+    // 清空累加器，开始一个新块
+    void begin();
+
+    // 叠加一路单声道输入 (frames <= MIXER_BLOCK_FRAMES)
+    void mix(uint8_t voice, const int16_t *in, int frames);
+
+    // 当前块的帧数 (= 最长的输入)
+    int frames() const { return _frames; }
+
+    // 饱和输出交织立体声，返回帧数
+    int output(int16_t *stereo);
+    // 饱和输出单声道 (I2S 单声道模式)，返回帧数
+    int outputMono(int16_t *mono);
+
+    // 累计削波 (饱和) 的采样数
+    uint32_t clipCount() const { return _clipped; }
+
+private:
+    int32_t _acc[MIXER_BLOCK_FRAMES];
+    int32_t _gain[MIX_VOICE_COUNT];
+    int _frames = 0;
+    uint32_t _clipped = 0;
+};
+
+#endif
@@ -0,0 +1,133 @@
+#include "App_RecBuffer.h"
+
+uint8_t *RecordBuffer::pool[REC_POOL_KEEP] = {};
+uint8_t RecordBuffer::poolCount = 0;
+portMUX_TYPE RecordBuffer::poolMux = portMUX_INITIALIZER_UNLOCKED;
+
+uint8_t *RecordBuffer::takeSegment() {
+    uint8_t *seg = NULL;
+    portENTER_CRITICAL(&poolMux);
+    if (poolCount > 0) seg = pool[--poolCount];
+    portEXIT_CRITICAL(&poolMux);
+    // 池空了才向堆申请；只用 PSRAM，内部 RAM 留给 WiFi / LVGL
+    if (seg == NULL) seg = (uint8_t *)ps_malloc(REC_SEGMENT_BYTES);
+    return seg;
+}
+
+void RecordBuffer::giveSegment(uint8_t *seg) {
+    portENTER_CRITICAL(&poolMux);
+    if (poolCount < REC_POOL_KEEP) {
+        pool[poolCount++] = seg;
+        seg = NULL;
+    }
+    portEXIT_CRITICAL(&poolMux);
+    if (seg) free(seg);
+}
+
+uint8_t *RecordBuffer::locate(uint32_t offset, uint32_t *room) const {
+    uint32_t idx = offset / REC_SEGMENT_BYTES;
+    uint32_t pos = offset % REC_SEGMENT_BYTES;
+    *room = REC_SEGMENT_BYTES - pos;
+    if (idx == 0 && lead > 0) {
+        // 第一段是旋转过的环形区：到段尾就绕回段首
+        pos += lead;
+        if (pos >= REC_SEGMENT_BYTES) pos -= REC_SEGMENT_BYTES;
+        else if (*room > REC_SEGMENT_BYTES - pos) *room = REC_SEGMENT_BYTES - pos;
+    }
+    return segs[idx] + pos;
+}
+
+uint8_t *RecordBuffer::writePtr(uint32_t offset, uint32_t *room) {
+    uint32_t idx = offset / REC_SEGMENT_BYTES;
+    if (idx >= REC_MAX_SEGMENTS) return NULL;
+
+    // 只会在末尾追加 (录音按顺序写)
+    while (used <= idx) {
+        uint8_t *seg = takeSegment();
+        if (seg == NULL) {
+            Serial.printf("[RecBuf] Segment alloc failed at %d KB!\n", used * (REC_SEGMENT_BYTES / 1024));
+            return NULL;
+        }
+        segs[used] = seg;
+        used = used + 1;
+        if (used > peak) peak = used;
+    }
+    return locate(offset, room);
+}
+
+const uint8_t *RecordBuffer::readPtr(uint32_t offset, uint32_t *len) const {
+    if (offset / REC_SEGMENT_BYTES >= used) return NULL;
+    uint32_t room;
+    const uint8_t *p = locate(offset, &room);
+    if (*len > room) *len = room;
+    return p;
+}
+
+int RecordBuffer::spans(uint32_t offset, uint32_t len, RecSpan *out, int maxSpans) const {
+    int n = 0;
+    while (len > 0 && n < maxSpans) {
+        uint32_t part = len;
+        const uint8_t *p = readPtr(offset, &part);
+        if (p == NULL) break;
+        out[n].data = p;
+        out[n].len = part;
+        n++;
+        offset += part;
+        len -= part;
+    }
+    return n;
+}
+
+bool RecordBuffer::write(uint32_t offset, const uint8_t *data, uint32_t len) {
+    while (len > 0) {
+        uint32_t room;
+        uint8_t *dst = writePtr(offset, &room);
+        if (dst == NULL) return false;
+        uint32_t n = (len < room) ? len : room;
+        memcpy(dst, data, n);
+        data += n;
+        offset += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool RecordBuffer::copyWithin(uint32_t dst, uint32_t src, uint32_t len) {
+    while (len > 0) {
+        uint32_t n = len;
+        const uint8_t *from = readPtr(src, &n);
+        if (from == NULL) return false;
+        uint32_t room;
+        uint8_t *to = writePtr(dst, &room);
+        if (to == NULL) return false;
+        if (n > room) n = room;
+        memcpy(to, from, n);
+        src += n;
+        dst += n;
+        len -= n;
+    }
+    return true;
+}
+
+void RecordBuffer::truncate(uint32_t len) {
+    uint16_t keep = (len + REC_SEGMENT_BYTES - 1) / REC_SEGMENT_BYTES;
+    while (used > keep) {
+        used = used - 1;
+        giveSegment(segs[used]);
+        segs[used] = NULL;
+    }
+    if (used == 0) lead = 0;
+}
+
+void RecordBuffer::release() {
+    truncate(0);
+}
+
+bool RecordBuffer::adoptLead(uint8_t *seg, uint32_t leadPos) {
+    if (used > 0 || seg == NULL) return false;
+    segs[0] = seg;
+    lead = leadPos % REC_SEGMENT_BYTES;
+    used = 1;
+    if (used > peak) peak = used;
+    return true;
+}
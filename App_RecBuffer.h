@@ -0,0 +1,75 @@
+#ifndef APP_REC_BUFFER_H
+#define APP_REC_BUFFER_H
+
+#include <Arduino.h>
+
+// 录音按固定大小的段存放在 PSRAM 中，录多长就占多少段
+#define REC_SEGMENT_BYTES   (32 * 1024)     // 1.024 秒 @16k 单声道
+#define REC_MAX_SEGMENTS    120             // 单次录音上限约 2 分钟 (3.75MB)
+#define REC_POOL_KEEP       4               // 归还后留在池里的段数 (所有录音共用)，常见短句不用反复向堆申请
+
+// 分散 / 聚集列表的一项：一段连续内存
+struct RecSpan {
+    const uint8_t *data;
+    uint32_t len;
+};
+
+/**
+ * 分段录音缓冲
+ * 对外是一个按字节偏移寻址的连续流，内部由按需申请的 PSRAM 段拼成。
+ * 写端 (录音任务) 只在末尾追加段；读端 (网络任务) 只读已发布的偏移，
+ * 段表是固定数组，追加时不会搬动已有的段指针，读写两端不需要加锁。
+ * 用完后 release() 把段还给池，池满的部分直接释放回堆。段池由所有实例共用，
+ * 同时存在多段录音 (一段在上传、一段在录) 时也只多占用正在使用的段。
+ * 第一段可以是接手过来的环形区 (预录音)：逻辑偏移 0 落在段内 lead 处，到段尾后绕回段首，
+ * 接手时不用把环形区的两半拷贝成顺序排列。
+ */
+class RecordBuffer {
+public:
+    // offset 处可写的连续内存，room 返回到段尾的字节数；需要新段时从池里取，
+    // 超过上限或 PSRAM 不足时返回 NULL
+    uint8_t *writePtr(uint32_t offset, uint32_t *room);
+
+    // offset 处已有数据的连续内存，len 截到段尾；段不存在返回 NULL
+    const uint8_t *readPtr(uint32_t offset, uint32_t *len) const;
+
+    // [offset, offset + len) 拆成最多 maxSpans 段连续内存，返回实际段数
+    int spans(uint32_t offset, uint32_t len, RecSpan *out, int maxSpans) const;
+
+    // 跨段写入 / 缓冲内搬移 (dst < src，不重叠)，空间不足时返回 false
+    bool write(uint32_t offset, const uint8_t *data, uint32_t len);
+    bool copyWithin(uint32_t dst, uint32_t src, uint32_t len);
+
+    // 只保留前 len 字节，之后的整段归还
+    void truncate(uint32_t len);
+    // 全部归还
+    void release();
+
+    // 空缓冲接手一个段 (takeSegment() 取得) 作为第一段，逻辑偏移 0 对应段内 leadPos 字节处；
+    // 缓冲非空时返回 false，段仍归调用方
+    bool adoptLead(uint8_t *seg, uint32_t leadPos);
+
+    // 段池：环形区等需要整段内存的地方也从这里取，交回时 (或随接手它的缓冲 release) 回到池里
+    static uint8_t *takeSegment();
+    static void giveSegment(uint8_t *seg);
+
+    uint32_t capacity() const { return (uint32_t)REC_MAX_SEGMENTS * REC_SEGMENT_BYTES; }
+    uint16_t segments() const { return used; }
+    uint16_t peakSegments() const { return peak; }
+    static uint8_t pooled() { return poolCount; }
+
+private:
+    // 逻辑偏移 -> 段内指针，room 为到 (段尾或第一段的绕回点) 的连续字节数
+    uint8_t *locate(uint32_t offset, uint32_t *room) const;
+
+    uint8_t *segs[REC_MAX_SEGMENTS] = {};
+    volatile uint16_t used = 0;
+    uint32_t lead = 0;          // 第一段的旋转量 (接手环形区时非 0)
+    uint16_t peak = 0;
+
+    static uint8_t *pool[REC_POOL_KEEP];
+    static uint8_t poolCount;
+    static portMUX_TYPE poolMux;
+};
+
+#endif
@@ -0,0 +1,260 @@
+#include "App_ReplyCache.h"
+
+AppReplyCache MyReplyCache;
+
+#define REPLY_CACHE_MAGIC 0x31494352  // "RCI1"
+
+bool AppReplyCache::begin() {
+    if (!LittleFS.begin(true, "/littlefs", 4, REPLY_CACHE_PARTITION)) {
+        Serial.println("[Cache] LittleFS mount failed, reply cache disabled.");
+        return false;
+    }
+    if (!LittleFS.exists(REPLY_CACHE_DIR)) LittleFS.mkdir(REPLY_CACHE_DIR);
+    // 上次写到一半断电留下的临时文件
+    if (LittleFS.exists(REPLY_CACHE_TMP)) LittleFS.remove(REPLY_CACHE_TMP);
+
+    mounted = true;
+    if (!loadIndex()) {
+        // 索引不存在或版本不符：清掉旧文件重新开始
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.magic = REPLY_CACHE_MAGIC;
+        for (int i = 0; i < REPLY_CACHE_MAX_ENTRIES; i++) {
+            char path[24];
+            slotPath(i, path);
+            if (LittleFS.exists(path)) LittleFS.remove(path);
+            entries[i].used = false;
+        }
+        saveIndex();
+    }
+
+    Serial.printf("[Cache] Ready: %d clips, %d KB used, fs %d/%d KB.\n",
+                  getStats().entries, bytesUsed() / 1024,
+                  LittleFS.usedBytes() / 1024, LittleFS.totalBytes() / 1024);
+    return true;
+}
+
+bool AppReplyCache::loadIndex() {
+    File f = LittleFS.open(REPLY_CACHE_INDEX, "r");
+    if (!f) return false;
+    bool ok = f.read((uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic == REPLY_CACHE_MAGIC &&
+              f.read((uint8_t *)entries, sizeof(entries)) == sizeof(entries);
+    f.close();
+    if (!ok) return false;
+
+    // 索引与文件对不上的条目 (如写索引前断电) 直接丢掉
+    bool dirty = false;
+    for (int i = 0; i < REPLY_CACHE_MAX_ENTRIES; i++) {
+        char path[24];
+        slotPath(i, path);
+        if (!entries[i].used) {
+            if (LittleFS.exists(path)) LittleFS.remove(path);
+            continue;
+        }
+        entries[i].id[REPLY_CACHE_ID_LEN] = 0;
+        File clip = LittleFS.open(path, "r");
+        if (!clip || clip.size() != entries[i].size) {
+            Serial.printf("[Cache] Dropping broken entry %d (%s).\n", i, entries[i].id);
+            if (clip) clip.close();
+            removeSlot(i);
+            dirty = true;
+            continue;
+        }
+        clip.close();
+    }
+    if (dirty) saveIndex();
+    return true;
+}
+
+void AppReplyCache::saveIndex() {
+    // 先写临时索引再改名，写到一半断电时旧索引仍然完整
+    File f = LittleFS.open(REPLY_CACHE_INDEX ".tmp", "w");
+    if (!f) {
+        Serial.println("[Cache] Failed to write index.");
+        return;
+    }
+    f.write((const uint8_t *)&hdr, sizeof(hdr));
+    f.write((const uint8_t *)entries, sizeof(entries));
+    f.close();
+    LittleFS.remove(REPLY_CACHE_INDEX);
+    LittleFS.rename(REPLY_CACHE_INDEX ".tmp", REPLY_CACHE_INDEX);
+    indexDirty = false;
+    lastSaveMs = millis();
+}
+
+// 只有 LRU 时钟 / 统计变了：先记下，距上次保存超过 REPLY_CACHE_SAVE_MS 才写，否则等 flushIdle()。
+// 断电最多丢掉最近一轮对话的命中记录，条目本身不受影响
+void AppReplyCache::touchIndex() {
+    indexDirty = true;
+    lastTouchMs = millis();
+    if (lastTouchMs - lastSaveMs >= REPLY_CACHE_SAVE_MS) saveIndex();
+}
+
+void AppReplyCache::flushIdle() {
+    if (indexDirty && millis() - lastTouchMs >= REPLY_CACHE_IDLE_SAVE_MS) saveIndex();
+}
+
+void AppReplyCache::slotPath(int slot, char *path) {
+    // 文件按槽位编号命名，ID 只存在索引里 (ID 可能比文件名长度上限还长)
+    sprintf(path, REPLY_CACHE_DIR "/%02d.wav", slot);
+}
+
+int AppReplyCache::find(const char *id) {
+    for (int i = 0; i < REPLY_CACHE_MAX_ENTRIES; i++) {
+        if (entries[i].used && strcmp(entries[i].id, id) == 0) return i;
+    }
+    return -1;
+}
+
+int AppReplyCache::freeSlot() {
+    for (int i = 0; i < REPLY_CACHE_MAX_ENTRIES; i++) {
+        if (!entries[i].used) return i;
+    }
+    return -1;
+}
+
+uint32_t AppReplyCache::bytesUsed() {
+    uint32_t total = 0;
+    for (int i = 0; i < REPLY_CACHE_MAX_ENTRIES; i++) {
+        if (entries[i].used) total += entries[i].size;
+    }
+    return total;
+}
+
+void AppReplyCache::removeSlot(int slot) {
+    char path[24];
+    slotPath(slot, path);
+    LittleFS.remove(path);
+    entries[slot].used = false;
+}
+
+// 淘汰最久没用过的一条，没有可淘汰的返回 false
+bool AppReplyCache::evictOne() {
+    int oldest = -1;
+    for (int i = 0; i < REPLY_CACHE_MAX_ENTRIES; i++) {
+        if (entries[i].used && (oldest < 0 || entries[i].lastUse < entries[oldest].lastUse)) oldest = i;
+    }
+    if (oldest < 0) return false;
+    Serial.printf("[Cache] Evict %s (%d bytes).\n", entries[oldest].id, entries[oldest].size);
+    removeSlot(oldest);
+    evictions++;
+    return true;
+}
+
+bool AppReplyCache::lookup(const char *id, File &file, ReplyCodec &codec) {
+    if (!mounted || id == NULL || id[0] == 0) return false;
+
+    hdr.lookups++;
+    int slot = find(id);
+    if (slot >= 0) {
+        char path[24];
+        slotPath(slot, path);
+        file = LittleFS.open(path, "r");
+        if (!file) {
+            removeSlot(slot);
+            saveIndex();
+            slot = -1;
+        }
+    }
+    if (slot < 0) {
+        Serial.printf("[Cache] Miss: %s\n", id);
+        touchIndex();
+        return false;
+    }
+
+    hdr.hits++;
+    hdr.bytesSaved += entries[slot].size;
+    entries[slot].lastUse = ++hdr.clock;
+    codec = (ReplyCodec)entries[slot].codec;
+    touchIndex();
+    Serial.printf("[Cache] Hit: %s (%d bytes)\n", id, entries[slot].size);
+    return true;
+}
+
+Print *AppReplyCache::beginStore(const char *id, uint32_t size, ReplyCodec codec) {
+    if (!mounted || storing || id == NULL || id[0] == 0) return NULL;
+    if (strlen(id) > REPLY_CACHE_ID_LEN || size > REPLY_CACHE_MAX_CLIP || codec == REPLY_CODEC_UNSUPPORTED) {
+        return NULL;
+    }
+
+    // 同一 ID 重新下发 (如服务器换了音色)：旧条目作废
+    int old = find(id);
+    if (old >= 0) removeSlot(old);
+
+    // 按 LRU 腾出条目、缓存上限和文件系统剩余空间
+    for (;;) {
+        size_t fs_free = LittleFS.totalBytes() - LittleFS.usedBytes();
+        bool fits = freeSlot() >= 0 && bytesUsed() + size <= REPLY_CACHE_MAX_BYTES &&
+                    fs_free >= size + REPLY_CACHE_FS_RESERVE;
+        if (fits) break;
+        if (!evictOne()) {
+            Serial.println("[Cache] No room for reply clip.");
+            saveIndex();
+            return NULL;
+        }
+    }
+
+    storeFile = LittleFS.open(REPLY_CACHE_TMP, "w");
+    if (!storeFile) return NULL;
+    strcpy(storeId, id);
+    storeCodec = codec;
+    storing = true;
+    return &storeFile;
+}
+
+void AppReplyCache::endStore(bool complete) {
+    if (!storing) return;
+    storing = false;
+
+    uint32_t size = storeFile.size();
+    storeFile.close();
+
+    int slot = freeSlot();
+    char path[24];
+    if (!complete || size == 0 || slot < 0) {
+        LittleFS.remove(REPLY_CACHE_TMP);
+        saveIndex();
+        return;
+    }
+
+    slotPath(slot, path);
+    LittleFS.remove(path);
+    if (!LittleFS.rename(REPLY_CACHE_TMP, path)) {
+        LittleFS.remove(REPLY_CACHE_TMP);
+        saveIndex();
+        return;
+    }
+
+    Entry &e = entries[slot];
+    strcpy(e.id, storeId);
+    e.codec = storeCodec;
+    e.size = size;
+    e.lastUse = ++hdr.clock;
+    e.used = true;
+    stores++;
+    saveIndex();
+    Serial.printf("[Cache] Stored %s (%d bytes) in slot %d.\n", storeId, size, slot);
+}
+
+AppReplyCache::Stats AppReplyCache::getStats() {
+    Stats s;
+    s.lookups = hdr.lookups;
+    s.hits = hdr.hits;
+    s.stores = stores;
+    s.evictions = evictions;
+    s.bytes_saved = hdr.bytesSaved;
+    s.entries = 0;
+    for (int i = 0; i < REPLY_CACHE_MAX_ENTRIES; i++) {
+        if (entries[i].used) s.entries++;
+    }
+    s.bytes_used = bytesUsed();
+    return s;
+}
+
+void AppReplyCache::printStats() {
+    if (!mounted) return;
+    Stats s = getStats();
+    Serial.printf("[Cache] hit %d/%d (%d%%), saved %d KB, %d clips / %d KB, stored %d, evicted %d\n",
+                  s.hits, s.lookups, s.lookups ? s.hits * 100 / s.lookups : 0,
+                  (uint32_t)(s.bytes_saved / 1024), s.entries, s.bytes_used / 1024,
+                  s.stores, s.evictions);
+}
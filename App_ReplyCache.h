@@ -0,0 +1,114 @@
+#ifndef APP_REPLY_CACHE_H
+#define APP_REPLY_CACHE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <LittleFS.h>
+#include "App_Audio.h"
+
+// 回复音频缓存放在 LittleFS 数据分区 (Arduino 默认分区表里这个分区叫 spiffs)
+#define REPLY_CACHE_PARTITION   "spiffs"
+#define REPLY_CACHE_DIR         "/rc"
+#define REPLY_CACHE_INDEX       "/rc/index.bin"
+#define REPLY_CACHE_TMP         "/rc/tmp.wav"
+
+#define REPLY_CACHE_MAX_BYTES   (512 * 1024)  // 缓存总大小上限
+#define REPLY_CACHE_MAX_CLIP    (128 * 1024)  // 单条回复超过这个大小不缓存，免得一条长回复挤掉所有常用短句
+#define REPLY_CACHE_MAX_ENTRIES 32
+#define REPLY_CACHE_ID_LEN      64            // ID 最长字符数 (足够放 SHA-256 十六进制)
+#define REPLY_CACHE_FS_RESERVE  (8 * 1024)    // 文件系统至少留出的空间 (元数据 / 索引重写)
+// 命中只改 LRU 时钟和统计，不值得每次都重写索引 (每次都是一次 Flash 擦写)；
+// 新增 / 淘汰条目时立即保存，仅命中时最多每隔 SAVE_MS 写一次，
+// 其余的由网络任务空闲时 (最后一次查询之后 IDLE_SAVE_MS) 补写
+#define REPLY_CACHE_SAVE_MS     (5 * 60 * 1000)
+#define REPLY_CACHE_IDLE_SAVE_MS (30 * 1000)
+
+// 回复 JSON 带 audio_id 时，设备读完 JSON 后回一个字节告诉服务器本地有没有这段音频；
+// 命中时服务器只发 4 字节的 0 长度，不再发音频
+#define REPLY_CACHE_MISS        0x00
+#define REPLY_CACHE_HIT         0x01
+
+/**
+ * 常用 TTS 回复的本地缓存 (按内容寻址)
+ * "好的"、"空调已打开" 这类回复每次都一样，服务器用文本哈希作为 audio_id，
+ * 设备命中时直接从 Flash 播放，省掉 TTS 和整段音频的下载。
+ * 按最近使用时间淘汰 (LRU)，总大小受 REPLY_CACHE_MAX_BYTES 限制。
+ * 只在网络任务中使用，不加锁。
+ */
+class AppReplyCache {
+public:
+    struct Stats {
+        uint32_t lookups;       // 查询次数 (回复带 audio_id 的次数)
+        uint32_t hits;          // 命中次数
+        uint32_t stores;        // 本次开机写入的条数
+        uint32_t evictions;     // 本次开机淘汰的条数
+        uint64_t bytes_saved;   // 命中省下的下载字节数
+        uint32_t entries;       // 当前条数
+        uint32_t bytes_used;    // 当前占用 (音频字节)
+    };
+
+    // 挂载文件系统并加载索引 (首次使用会格式化分区，耗时数秒)
+    bool begin();
+
+    // 查找 id：命中时打开对应文件，返回 true；查询计入命中率统计
+    bool lookup(const char *id, File &file, ReplyCodec &codec);
+
+    // 开始缓存一段正在下载的回复，返回写入目标 (交给 playStream 边播边写)；
+    // 不适合缓存时返回 NULL。必要时先按 LRU 腾出空间
+    Print *beginStore(const char *id, uint32_t size, ReplyCodec codec);
+
+    // 下载结束：complete 为 true 时提交为新条目，否则丢弃临时文件
+    void endStore(bool complete);
+
+    // 网络任务空闲时调用：命中记录攒着没写的，最后一次查询过去 REPLY_CACHE_IDLE_SAVE_MS 后写回
+    void flushIdle();
+
+    Stats getStats();
+    void printStats();
+
+private:
+    struct Entry {
+        char id[REPLY_CACHE_ID_LEN + 1];
+        uint8_t codec;
+        bool used;
+        uint32_t size;
+        uint32_t lastUse;       // LRU 时钟，越大越新
+    };
+
+    // 索引文件头；命中率统计跟着索引一起保存，重启后继续累计
+    struct IndexHeader {
+        uint32_t magic;
+        uint32_t clock;
+        uint32_t lookups;
+        uint32_t hits;
+        uint64_t bytesSaved;
+    };
+
+    int find(const char *id);
+    int freeSlot();
+    bool evictOne();
+    void removeSlot(int slot);
+    void slotPath(int slot, char *path);
+    bool loadIndex();
+    void saveIndex();
+    void touchIndex();
+    uint32_t bytesUsed();
+
+    bool mounted = false;
+    Entry entries[REPLY_CACHE_MAX_ENTRIES];
+    IndexHeader hdr;
+    bool indexDirty = false;    // 内存里的索引比 Flash 上的新 (只差 LRU 时钟 / 统计)
+    uint32_t lastSaveMs = 0;
+    uint32_t lastTouchMs = 0;
+    uint32_t stores = 0;
+    uint32_t evictions = 0;
+
+    File storeFile;
+    bool storing = false;
+    char storeId[REPLY_CACHE_ID_LEN + 1];
+    uint8_t storeCodec = 0;
+};
+
+extern AppReplyCache MyReplyCache;
+
+#endif
@@ -0,0 +1,105 @@
+#include "App_Resampler.h"
+#include <math.h>
+
+static uint32_t gcd(uint32_t a, uint32_t b) {
+    while (b) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+bool PolyphaseResampler::begin(uint32_t inRate, uint32_t outRate) {
+    if (inRate == 0 || outRate == 0) return false;
+
+    uint32_t g = gcd(inRate, outRate);
+    _up = outRate / g;
+    _down = inRate / g;
+    _bypass = (_up == _down);
+    reset();
+    if (_bypass) return true;
+
+    // 截止频率 (相对输入采样率)：取两者奈奎斯特频率的较小值，留 10% 过渡带
+    float ratio = (outRate < inRate) ? (float)outRate / inRate : 1.0f;
+    float fc = 0.5f * ratio * 0.9f;
+    const int half = RESAMPLER_TAPS / 2;
+
+    for (int p = 0; p <= RESAMPLER_PHASES; p++) {
+        float frac = (float)p / RESAMPLER_PHASES;
+        float h[RESAMPLER_TAPS];
+        float sum = 0;
+        for (int j = 0; j < RESAMPLER_TAPS; j++) {
+            // 抽头 j 对应的输入采样与输出时刻的距离
+            float d = (j - half + 1) - frac;
+            float x = 2.0f * fc * d;
+            float sinc = (fabsf(x) < 1e-6f) ? 1.0f : sinf(PI * x) / (PI * x);
+            // Blackman 窗，窗宽覆盖全部抽头
+            float t = (d + half) / RESAMPLER_TAPS;
+            float w = 0.42f - 0.5f * cosf(2.0f * PI * t) + 0.08f * cosf(4.0f * PI * t);
+            if (t <= 0.0f || t >= 1.0f) w = 0.0f;
+            h[j] = 2.0f * fc * sinc * w;
+            sum += h[j];
+        }
+        // 每个相位单独归一化，直流增益恰好为 1
+        for (int j = 0; j < RESAMPLER_TAPS; j++) {
+            _coef[p][j] = (int16_t)lrintf(h[j] / sum * 32767.0f);
+        }
+    }
+
+    Serial.printf("[Resample] %u -> %u Hz (L/M = %u/%u)\n", inRate, outRate, _up, _down);
+    return true;
+}
+
+void PolyphaseResampler::reset() {
+    memset(_hist, 0, sizeof(_hist));
+    _pos = 0;
+    _acc = 0;
+}
+
+size_t PolyphaseResampler::maxOutput(size_t count) const {
+    if (_bypass) return count;
+    return (count * _up + _down - 1) / _down + 1;
+}
+
+int32_t PolyphaseResampler::dot(const int16_t *x, const int16_t *h) const {
+    int32_t acc = 0;
+    for (int j = 0; j < RESAMPLER_TAPS; j++) {
+        acc += (int32_t)x[j] * h[j];
+    }
+    return acc;
+}
+
+size_t PolyphaseResampler::process(const int16_t *in, size_t count, int16_t *out) {
+    if (_bypass) {
+        memcpy(out, in, count * sizeof(int16_t));
+        return count;
+    }
+
+    size_t produced = 0;
+    for (size_t i = 0; i < count; i++) {
+        _hist[_pos] = in[i];
+        _hist[_pos + RESAMPLER_TAPS] = in[i];
+        _pos = (_pos + 1) % RESAMPLER_TAPS;
+        // 最旧的采样在 _hist[_pos]，最新的在 _hist[_pos + RESAMPLER_TAPS - 1]
+        const int16_t *x = _hist + _pos;
+
+        // 输出时刻落在 (倒数第 half 个, 倒数第 half-1 个) 采样之间，固定延迟 RESAMPLER_TAPS / 2
+        while (_acc < _up) {
+            uint32_t scaled = _acc * RESAMPLER_PHASES;
+            uint32_t p = scaled / _up;
+            int32_t w = (int32_t)(((uint64_t)(scaled % _up) << 15) / _up);
+
+            int32_t a = dot(x, _coef[p]) >> 15;
+            int32_t b = dot(x, _coef[p + 1]) >> 15;
+            int32_t y = a + (int32_t)(((int64_t)(b - a) * w) >> 15);
+
+            if (y > 32767) y = 32767;
+            else if (y < -32768) y = -32768;
+            out[produced++] = (int16_t)y;
+            _acc += _down;
+        }
+        _acc -= _up;
+    }
+    return produced;
+}
@@ -0,0 +1,47 @@
+#ifndef APP_RESAMPLER_H
+#define APP_RESAMPLER_H
+
+#include <Arduino.h>
+
+// 每个输出采样的 FIR 抽头数，以及把两个输入采样之间的间隔分成多少相位
+#define RESAMPLER_TAPS      32
+#define RESAMPLER_PHASES    32
+
+/**
+ * 定点多相重采样器 (单声道 16bit)
+ * 任意整数采样率之比：输入 / 输出率约分为 M / L，用整数累加器定位每个输出采样，
+ * 相位表之间线性插值，所以 22.05k / 24k / 44.1k 等都不需要 L 个相位的大表。
+ * 系数表在 begin() 中按比例生成 (加窗 sinc，降采样时截止频率随之降低做抗混叠)，
+ * 运行时只有整数乘加；内存固定为系数表 + 一条 RESAMPLER_TAPS 的延迟线。
+ */
+class PolyphaseResampler {
+public:
+    bool begin(uint32_t inRate, uint32_t outRate);
+    void reset();
+
+    // 输入采样率与输出一致时直接拷贝
+    bool isBypass() const { return _bypass; }
+
+    // 喂入 count 个采样，输出写到 out，返回输出采样数
+    // out 至少需要 maxOutput(count) 个采样
+    size_t process(const int16_t *in, size_t count, int16_t *out);
+
+    size_t maxOutput(size_t count) const;
+
+private:
+    int32_t dot(const int16_t *x, const int16_t *h) const;
+
+    bool _bypass = true;
+    uint32_t _up = 1;           // L：输出率 / gcd
+    uint32_t _down = 1;         // M：输入率 / gcd
+    uint32_t _acc = 0;          // 下一个输出采样在当前输入间隔内的位置 (单位 1/L)
+
+    // 延迟线存两份，任何位置都能取到连续的 RESAMPLER_TAPS 个采样，不用取模
+    int16_t _hist[RESAMPLER_TAPS * 2];
+    uint16_t _pos = 0;
+
+    // 相位 0..RESAMPLER_PHASES (多一行方便插值)，Q15，每行之和为 1
+    int16_t _coef[RESAMPLER_PHASES + 1][RESAMPLER_TAPS];
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include "App_RingBuffer.h"
+
+bool AudioRingBuffer::begin(size_t capacity, size_t prebuffer) {
+    _buf = (uint8_t *)ps_malloc(capacity);
+    if (_buf == NULL) {
+        Serial.println("[Ring] PSRAM alloc failed!");
+        return false;
+    }
+    _cap = capacity;
+    _prebuffer = (prebuffer > capacity) ? capacity : prebuffer;
+    _dataSem = xSemaphoreCreateBinary();
+    _spaceSem = xSemaphoreCreateBinary();
+    reset();
+    Serial.printf("[Ring] %d bytes in PSRAM, prebuffer %d bytes.\n", capacity, _prebuffer);
+    return true;
+}
+
+void AudioRingBuffer::reset() {
+    portENTER_CRITICAL(&_mux);
+    _head = _tail = _fill = 0;
+    _primed = false;
+    _eof = false;
+    _underruns = _overruns = 0;
+    _minFill = _cap;
+    _maxFill = 0;
+    _fillSum = 0;
+    _fillSamples = 0;
+    portEXIT_CRITICAL(&_mux);
+}
+
+void AudioRingBuffer::setPrebuffer(size_t bytes) {
+    portENTER_CRITICAL(&_mux);
+    _prebuffer = (bytes > _cap) ? _cap : bytes;
+    portEXIT_CRITICAL(&_mux);
+}
+
+size_t AudioRingBuffer::write(const uint8_t *data, size_t len, TickType_t wait) {
+    if (_buf == NULL) return 0;
+    size_t done = 0;
+
+    while (done < len) {
+        portENTER_CRITICAL(&_mux);
+        size_t space = _cap - _fill;
+        portEXIT_CRITICAL(&_mux);
+
+        if (space == 0) {
+            _overruns++;
+            if (xSemaphoreTake(_spaceSem, wait) != pdTRUE) break;
+            continue;
+        }
+
+        // 只有生产者移动 _head，拷贝可以在锁外进行
+        size_t n = len - done;
+        if (n > space) n = space;
+        size_t first = _cap - _head;
+        if (first > n) first = n;
+        memcpy(_buf + _head, data + done, first);
+        memcpy(_buf, data + done + first, n - first);
+
+        portENTER_CRITICAL(&_mux);
+        _head = (_head + n) % _cap;
+        _fill += n;
+        if (_fill > _maxFill) _maxFill = _fill;
+        portEXIT_CRITICAL(&_mux);
+
+        done += n;
+        xSemaphoreGive(_dataSem);
+    }
+    return done;
+}
+
+size_t AudioRingBuffer::read(uint8_t *data, size_t len, TickType_t wait) {
+    if (_buf == NULL) return 0;
+
+    for (;;) {
+        portENTER_CRITICAL(&_mux);
+        size_t fill = _fill;
+        bool eof = _eof;
+        if (!_primed && (fill >= _prebuffer || eof)) _primed = true;
+        bool primed = _primed;
+        if (primed && fill == 0 && !eof) {
+            // 播放中被读空：记一次欠载，重新攒预缓冲，避免断断续续
+            _underruns++;
+            _primed = false;
+        }
+        portEXIT_CRITICAL(&_mux);
+
+        if (primed && fill > 0) break;
+        if (eof && fill == 0) return 0;
+        if (xSemaphoreTake(_dataSem, wait) != pdTRUE) return 0;
+    }
+
+    portENTER_CRITICAL(&_mux);
+    size_t fill = _fill;
+    if (fill < _minFill) _minFill = fill;
+    _fillSum += fill;
+    _fillSamples++;
+    portEXIT_CRITICAL(&_mux);
+
+    size_t n = (len > fill) ? fill : len;
+    size_t first = _cap - _tail;
+    if (first > n) first = n;
+    memcpy(data, _buf + _tail, first);
+    memcpy(data + first, _buf, n - first);
+
+    portENTER_CRITICAL(&_mux);
+    _tail = (_tail + n) % _cap;
+    _fill -= n;
+    portEXIT_CRITICAL(&_mux);
+
+    xSemaphoreGive(_spaceSem);
+    return n;
+}
+
+void AudioRingBuffer::finish() {
+    portENTER_CRITICAL(&_mux);
+    _eof = true;
+    portEXIT_CRITICAL(&_mux);
+    xSemaphoreGive(_dataSem);
+}
+
+bool AudioRingBuffer::isFinished() {
+    portENTER_CRITICAL(&_mux);
+    bool done = _eof && _fill == 0;
+    portEXIT_CRITICAL(&_mux);
+    return done;
+}
+
+size_t AudioRingBuffer::available() {
+    portENTER_CRITICAL(&_mux);
+    size_t fill = _fill;
+    portEXIT_CRITICAL(&_mux);
+    return fill;
+}
+
+AudioRingBuffer::Stats AudioRingBuffer::getStats() {
+    Stats s;
+    portENTER_CRITICAL(&_mux);
+    s.underruns = _underruns;
+    s.overruns = _overruns;
+    s.capacity = _cap;
+    s.fill = _fill;
+    s.min_fill = (_fillSamples > 0) ? _minFill : 0;
+    s.max_fill = _maxFill;
+    s.avg_fill = (_fillSamples > 0) ? (uint32_t)(_fillSum / _fillSamples) : 0;
+    portEXIT_CRITICAL(&_mux);
+    return s;
+}
@@ -0,0 +1,66 @@
+#ifndef APP_RING_BUFFER_H
+#define APP_RING_BUFFER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+/**
+ * 音频抖动缓冲 (单生产者 / 单消费者)
+ * 网络任务写入，播放任务读出；缓冲区放在 PSRAM 中。
+ * 读端在开始播放前会先攒够 prebuffer 字节，网络抖动时不至于立刻断音。
+ */
+class AudioRingBuffer {
+public:
+    struct Stats {
+        uint32_t underruns;  // 播放中缓冲被读空的次数
+        uint32_t overruns;   // 写入时缓冲已满 (网络被 I2S 反压) 的次数
+        uint32_t capacity;   // 总容量 (字节)
+        uint32_t fill;       // 当前水位
+        uint32_t min_fill;   // 开始播放后的最低水位
+        uint32_t max_fill;   // 最高水位
+        uint32_t avg_fill;   // 平均水位 (每次读取时采样)
+    };
+
+    bool begin(size_t capacity, size_t prebuffer);
+
+    // 清空缓冲和统计，开始一段新的流
+    void reset();
+    void setPrebuffer(size_t bytes);
+
+    // 写入数据，缓冲满时最多等待 wait，返回实际写入字节数
+    size_t write(const uint8_t *data, size_t len, TickType_t wait);
+
+    // 读出数据，未攒够预缓冲或缓冲为空时最多等待 wait，返回实际读出字节数
+    size_t read(uint8_t *data, size_t len, TickType_t wait);
+
+    // 生产者写完，读端取完剩余数据后即结束
+    void finish();
+    bool isFinished();
+
+    size_t available();
+    Stats getStats();
+
+private:
+    uint8_t *_buf = NULL;
+    size_t _cap = 0;
+    size_t _head = 0;       // 写位置 (只由生产者修改)
+    size_t _tail = 0;       // 读位置 (只由消费者修改)
+    size_t _fill = 0;       // 当前数据量 (加锁修改)
+    size_t _prebuffer = 0;
+    bool _primed = false;   // 已攒够预缓冲，开始放行
+    bool _eof = false;
+
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+    SemaphoreHandle_t _dataSem = NULL;   // 有新数据
+    SemaphoreHandle_t _spaceSem = NULL;  // 有新空间
+
+    uint32_t _underruns = 0;
+    uint32_t _overruns = 0;
+    size_t _minFill = 0;
+    size_t _maxFill = 0;
+    uint64_t _fillSum = 0;
+    uint32_t _fillSamples = 0;
+};
+
+#endif
@@ -1,134 +1,290 @@
 #include "App_Server.h"
 #include "App_Audio.h"
-#include "App_IR.h" 
+#include "App_Command.h"
 #include "App_UI_Logic.h"
+#include "App_ReplyCache.h"
 
 AppServer MyServer;
 
 void AppServer::init(const char* ip, int port) {
-    server_ip = ip;
-    server_port = port;
+    session.init(ip, port);
+
+    // 服务器回复里设备关心的字段，其余 (调试信息、识别结果等) 解析时直接跳过
+    replyFilter["reply_text"] = true;
+    replyFilter["audio_format"] = true;
+    replyFilter["audio_id"] = true;
+    replyFilter["upload_format"] = true;
+    replyFilter["control"] = true;
 }
 
-void AppServer::chatWithServer() {
-    if (MyAudio.record_data_len == 0 || MyAudio.record_buffer == NULL) {
-        Serial.println("[Server] No audio to send.");
-        return;
+bool AppServer::parseReply(uint32_t len) {
+    replyDoc.clear();
+    if (len > REPLY_JSON_MAX) {
+        Serial.printf("[Server] JSON too large (%u > %d bytes), rejected.\n", len, REPLY_JSON_MAX);
+        return false;
+    }
+
+    FramePayloadStream in(&session, SESSION_JSON_TIMEOUT_MS);
+    DeserializationError error = deserializeJson(replyDoc, in, DeserializationOption::Filter(replyFilter));
+    if (in.timedOut()) {
+        Serial.println("[Server] JSON frame truncated.");
+        return false;
+    }
+    if (error) {
+        // 内容有问题但帧是完整的，剩余 payload 由下一次读帧头跳过，事务照常进行
+        Serial.print("[Server] JSON Deserialize Error: ");
+        Serial.println(error.c_str());
+        replyDoc.clear();
+        return true;
     }
+    Serial.printf("[Server] JSON (%u bytes, %u in arena): ", len, replyDoc.memoryUsage());
+    serializeJson(replyDoc, Serial);
+    Serial.println();
+    return true;
+}
+
+void AppServer::poll() {
+    session.poll();
+}
+
+void AppServer::disconnect() {
+    session.close();
+}
+
+void AppServer::printStats() {
+    session.printStats();
+}
 
-    WiFiClient client;
-    Serial.printf("[Server] Connecting to %s:%d...\n", server_ip, server_port);
+// 等待分片的超时：录音期间录音任务至少每 REC_KEEPALIVE_MS 发一个分片或心跳 (开口前、句中停顿也一样)，
+// 2 秒什么都没收到说明录音任务卡住了
+#define STREAM_CHUNK_TIMEOUT_MS 2000
 
-    if (!client.connect(server_ip, server_port)) {
+void AppServer::streamChatWithServer(Recording *rec) {
+    // 长连接通常已经就绪；断了的话在这里重连，TCP 握手与用户说话并行
+    if (!session.begin()) {
         Serial.println("[Server] Connection failed!");
+        discardStream(rec);
         MyUILogic.finishAIState();
         return;
     }
+    applyCaps();
+    Serial.printf("[Server] Streaming (txn %d)...\n", session.currentTxn());
 
-    // 1. 发送录音数据
-    Serial.println("[Server] Sending audio...");
-    client.write(MyAudio.record_buffer, MyAudio.record_data_len);
-    client.flush();
-    
-    // 2. 读取响应头：JSON 长度 (4字节大端)
-    int timeout = 10000;
-    while (client.available() < 4 && timeout > 0) {
-        delay(10);
-        timeout -= 10;
+    // 1. 分片到达即发送，第一个分片带流式 WAV 头 (ADPCM 模式下另发 ADPCM 头)
+    uint32_t sent = beginUpload(ADPCM_UNKNOWN_LENGTH);
+    AudioChunk chunk;
+    for (;;) {
+        if (!MyAudio.waitChunk(rec, &chunk, pdMS_TO_TICKS(STREAM_CHUNK_TIMEOUT_MS))) {
+            Serial.println("[Server] Timeout waiting for audio chunk.");
+            MyAudio.releaseRecording(rec);
+            session.cancel();
+            MyUILogic.finishAIState();
+            return;
+        }
+        if (chunk.len > 0 && session.connected()) {
+            sent += sendRecording(rec, chunk.offset, chunk.len);
+        }
+        if (chunk.last) break;
     }
-    
-    if (client.available() < 4) {
-        Serial.println("[Server] Timeout waiting for response.");
-        client.stop();
+    MyAudio.releaseRecording(rec);
+
+    // 录音没开始 (录音池 / PSRAM 不足或已在录音) 时没有有效数据，撤销本次事务，连接留着
+    if (chunk.offset + chunk.len <= 44) {
+        Serial.println("[Server] No audio recorded.");
+        session.cancel();
+        MyUILogic.finishAIState();
+        return;
+    }
+
+    sent += endUpload();
+    if (!session.send(FRAME_AUDIO_END)) {
+        Serial.println("[Server] Connection lost during upload.");
+        session.end(false);
+        MyUILogic.finishAIState();
         return;
     }
+    Serial.printf("[Server] Streamed %d bytes.\n", sent);
+
+    handleReply();
+}
+
+void AppServer::discardStream(Recording *rec) {
+    AudioChunk chunk;
+    while (MyAudio.waitChunk(rec, &chunk, pdMS_TO_TICKS(STREAM_CHUNK_TIMEOUT_MS))) {
+        if (chunk.last) break;
+    }
+    MyAudio.releaseRecording(rec);
+}
+
+// 握手时服务器声明能收 ADPCM 就直接用，不必等第一次回复里的 upload_format
+void AppServer::applyCaps() {
+    if (session.caps() & FRAME_CAP_ADPCM_UPLOAD) setUploadFormat(UPLOAD_FORMAT_ADPCM);
+}
+
+void AppServer::setUploadFormat(UploadFormat fmt) {
+    if (fmt != upload_format) {
+        Serial.printf("[Server] Upload format -> %s\n", fmt == UPLOAD_FORMAT_ADPCM ? "IMA-ADPCM" : "PCM");
+    }
+    upload_format = fmt;
+}
+
+uint32_t AppServer::beginUpload(uint32_t totalSamples) {
+    if (upload_format != UPLOAD_FORMAT_ADPCM) return 0;
+
+    uint8_t header[ADPCM_WAV_HEADER_SIZE];
+    AdpcmEncoder::writeWavHeader(header, AUDIO_SAMPLE_RATE, totalSamples);
+    encoder.reset();
+    return session.sendAudio(header, sizeof(header));
+}
+
+uint32_t AppServer::sendRecording(Recording *rec, uint32_t offset, uint32_t len) {
+    // ADPCM 模式跳过录音开头的 PCM WAV 头 (另发了 ADPCM 头)
+    if (upload_format == UPLOAD_FORMAT_ADPCM && offset < 44) {
+        uint32_t skip = (len < 44 - offset) ? len : 44 - offset;
+        offset += skip;
+        len -= skip;
+    }
 
-    uint8_t len_buf[4];
-    client.readBytes(len_buf, 4);
-    uint32_t json_len = (len_buf[0] << 24) | (len_buf[1] << 16) | (len_buf[2] << 8) | len_buf[3];
-    Serial.printf("[Server] JSON Length: %d\n", json_len);
-
-    // 3. 读取 JSON 内容
-    char* json_str = (char*)malloc(json_len + 1);
-    if (json_str) {
-        int read_len = client.readBytes(json_str, json_len);
-        json_str[read_len] = 0; // 结尾
-        
-        Serial.printf("[Server] JSON: %s\n", json_str);
-        
-        StaticJsonDocument<1024> doc;
-        DeserializationError error = deserializeJson(doc, json_str);
-        
-        if (!error) {
-            const char* reply = doc["reply_text"];
-            if (reply) {
-                Serial.printf("[Server] Reply: %s\n", reply); 
-            }
-
-            // --- 修复开始：安全地解析 control 指令 ---
-            if (doc.containsKey("control")) {
-                bool has_command = doc["control"]["has_command"];
-                
-                if (has_command) {
-                    // 获取指针，可能为 NULL
-                    const char* target = doc["control"]["target"]; 
-                    const char* action = doc["control"]["action"]; 
-                    const char* value  = doc["control"]["value"];  
-
-                    // 打印调试信息，处理 NULL 情况
-                    Serial.printf("[Control] Target: %s, Action: %s, Value: %s\n", 
-                                  target ? target : "NULL", 
-                                  action ? action : "NULL", 
-                                  value ? value : "NULL");
-                    
-                    // 【必须修改】在 strcmp 前先检查非空，防止 Core Panic
-                    if (target != NULL) {
-                        if (strcmp(target, "空调") == 0) {
-                            // 检查 action 是否为空
-                            if (action != NULL) {
-                                if (strcmp(action, "开") == 0) {
-                                    MyIR.sendNEC(0x11111111); 
-                                } else if (strcmp(action, "关") == 0) {
-                                    MyIR.sendNEC(0x22222222); 
-                                }
-                            }
-                            // 检查 value 是否为空
-                            if (value != NULL && strcmp(value, "26") == 0) {
-                                MyIR.sendNEC(0x33333333); 
-                            }
-                        } 
-                        else if (strcmp(target, "灯") == 0) {
-                            if (action != NULL) {
-                                if (strcmp(action, "开") == 0) MyIR.sendNEC(0x44444444);
-                                else if (strcmp(action, "关") == 0) MyIR.sendNEC(0x55555555);
-                            }
-                        }
-                    } else {
-                        Serial.println("[Server] Warning: Command received but 'target' is NULL.");
-                    }
-                }
-            }
-            // --- 修复结束 ---
-
-        } else {
-            Serial.print("[Server] JSON Deserialize Error: ");
-            Serial.println(error.c_str());
+    // 录音是分段存放的，按分散 / 聚集列表逐段发送，不拼接成整块
+    uint32_t sent = 0;
+    RecSpan spans[REC_SPAN_BATCH];
+    while (len > 0) {
+        int n = MyAudio.getRecordSpans(rec, offset, len, spans, REC_SPAN_BATCH);
+        if (n == 0) break;
+        for (int i = 0; i < n; i++) {
+            sent += sendSpan(spans[i].data, spans[i].len);
+            offset += spans[i].len;
+            len -= spans[i].len;
         }
-        free(json_str);
+    }
+    return sent;
+}
+
+uint32_t AppServer::sendSpan(const uint8_t *data, uint32_t len) {
+    if (upload_format != UPLOAD_FORMAT_ADPCM) {
+        return session.sendAudio(data, len);
+    }
+
+    uint32_t sent = 0;
+    while (len > 0) {
+        uint32_t n = (len > ADPCM_SLICE_BYTES) ? ADPCM_SLICE_BYTES : len;
+        size_t out = encoder.encode((const int16_t *)data, n / 2, adpcm_buf);
+        if (out > 0) sent += session.sendAudio(adpcm_buf, out);
+        data += n;
+        len -= n;
+    }
+    return sent;
+}
+
+uint32_t AppServer::endUpload() {
+    if (upload_format != UPLOAD_FORMAT_ADPCM) return 0;
+
+    size_t out = encoder.flush(adpcm_buf);
+    return (out > 0) ? session.sendAudio(adpcm_buf, out) : 0;
+}
+
+void AppServer::handleReply() {
+    // 应答没读完整 (超时、截断) 时连接上的帧已经对不上了，只能断开，不能复用
+    bool clean = true;
+    FrameHeader h;
+
+    // 2. 等服务器的 JSON 帧 (识别 + 大模型，最慢)
+    if (!session.recvHeader(&h, SESSION_FIRST_BYTE_TIMEOUT_MS)) {
+        Serial.println("[Server] Timeout waiting for response.");
+        session.end(false);
+        MyUILogic.finishAIState();
+        return;
+    }
+    if (h.type != FRAME_JSON) {
+        // ERROR 帧已经结束了事务，连接还能用
+        if (h.type != FRAME_ERROR) Serial.printf("[Server] Unexpected frame 0x%02x instead of JSON\n", h.type);
+        session.end(h.type == FRAME_ERROR);
+        MyUILogic.finishAIState();
+        return;
     }
 
-    // 4. 读取音频长度
-    while (client.available() < 4) delay(1);
-    client.readBytes(len_buf, 4);
-    uint32_t audio_len = (len_buf[0] << 24) | (len_buf[1] << 16) | (len_buf[2] << 8) | len_buf[3];
+    // 回复音频编码 (JSON 中的 audio_format)，缺省为 PCM WAV
+    ReplyCodec reply_codec = REPLY_CODEC_PCM;
+    // 回复音频的内容 ID (JSON 中的 audio_id)，用于本地缓存
+    char audio_id[REPLY_CACHE_ID_LEN + 1] = "";
+
+    // 3. 直接从连接上解析 JSON (过滤掉不用的字段)；帧被截断或超长时后面的帧对不上了
+    if (!parseReply(h.len)) {
+        session.end(false);
+        MyUILogic.finishAIState();
+        return;
+    }
+    const char* reply = replyDoc["reply_text"];
+    if (reply) {
+        Serial.printf("[Server] Reply: %s\n", reply); 
+    }
+
+    // 回复音频的编码：压缩格式在 4G 下能大幅缩短首包时间
+    const char* audio_fmt = replyDoc["audio_format"];
+    if (audio_fmt) {
+        if (strcmp(audio_fmt, "ima_adpcm") == 0) reply_codec = REPLY_CODEC_IMA_ADPCM;
+        else if (strcmp(audio_fmt, "pcm") != 0) reply_codec = REPLY_CODEC_UNSUPPORTED;
+        Serial.printf("[Server] Reply audio format: %s\n", audio_fmt);
+    }
+
+    const char* id = replyDoc["audio_id"];
+    if (id && strlen(id) <= REPLY_CACHE_ID_LEN) strcpy(audio_id, id);
+
+    // 服务器声明可接收的上传格式，从下一次录音开始生效
+    const char* fmt = replyDoc["upload_format"];
+    if (fmt) {
+        setUploadFormat(strcmp(fmt, "ima_adpcm") == 0 ? UPLOAD_FORMAT_ADPCM : UPLOAD_FORMAT_PCM);
+    }
+
+    // 控制指令：查路由表转成红外 / 433 发送
+    JsonVariant control = replyDoc["control"];
+    if (control["has_command"]) {
+        MyCommand.dispatchJson(control, "target");
+    }
+
+    // 4. 带 audio_id 的回复先查本地缓存，回一个 CACHE 帧告诉服务器要不要发音频
+    File cached;
+    ReplyCodec cached_codec = REPLY_CODEC_PCM;
+    bool cache_hit = false;
+    if (audio_id[0]) {
+        cache_hit = MyReplyCache.lookup(audio_id, cached, cached_codec);
+        uint8_t answer = cache_hit ? REPLY_CACHE_HIT : REPLY_CACHE_MISS;
+        if (!session.send(FRAME_CACHE, &answer, 1)) clean = false;
+    }
+
+    // 5. REPLY_START 给出音频总长 (缓存命中或没有音频时为 0)
+    uint32_t audio_len = 0;
+    if (clean && session.recvHeader(&h, SESSION_AUDIO_START_TIMEOUT_MS) && h.type == FRAME_REPLY_START) {
+        uint8_t len_buf[4];
+        if (session.readPayload(len_buf, 4, SESSION_READ_TIMEOUT_MS) == 4) audio_len = FrameEncoder::getU32(len_buf);
+        else clean = false;
+    } else if (!session.replyDone()) {
+        clean = false;
+    }
     Serial.printf("[Server] Audio Length: %d\n", audio_len);
 
-    // 5. 播放音频流
-    if (audio_len > 0) {
-        MyAudio.playStream(&client, audio_len);
+    // 6. 播放音频：网络下发的优先 (服务器没理会缓存应答时也能正常播放)，边播边写入缓存
+    if (audio_len > 0 && clean) {
+        FrameAudioStream audio(&session);
+        Print *tee = MyReplyCache.beginStore(audio_id, audio_len, reply_codec);
+        bool complete = MyAudio.playStream(&audio, session.client(), audio_len, reply_codec, tee);
+        if (tee) MyReplyCache.endStore(complete);
+    } else if (cache_hit) {
+        MyAudio.playCached(&cached, cached.size(), cached_codec);
+    }
+    if (cached) cached.close();
+    if (audio_id[0]) MyReplyCache.printStats();
+    Recording *next = MyAudio.takeBargeIn();
+    if (next) {
+        // 用户打断了回复：录音已经在音频侧开始；让服务器停发剩余回复，连接留给新一轮请求
+        session.cancel();
+        MyUILogic.startBargeInTurn(next);
+        return;
     }
     Serial.println("[Server] Playback finished. Restoring UI.");
     MyUILogic.finishAIState(); 
-    client.stop();
-    Serial.println("[Server] Transaction Done.");
+    // 没播完的 (如 data 块后的附加块) 读到 REPLY_END 为止，连接就能接着用
+    if (clean) clean = session.finishReply(SESSION_AUDIO_TIMEOUT_MS);
+    session.end(clean);
+    Serial.printf("[Server] Transaction %d done (%s).\n", session.currentTxn(), clean ? "connection kept" : "connection closed");
 }
\ No newline at end of file
@@ -4,17 +4,74 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <ArduinoJson.h> // 需要安装 ArduinoJson 库
+#include "App_Adpcm.h"
+#include "App_Audio.h"
+#include "App_Session.h"
+
+// 上传音频格式：默认 PCM WAV；握手时服务器声明 FRAME_CAP_ADPCM_UPLOAD，或在回复 JSON 中声明
+// "upload_format": "ima_adpcm" 后，后续上传改为 IMA-ADPCM WAV (约 4:1)
+enum UploadFormat {
+    UPLOAD_FORMAT_PCM,
+    UPLOAD_FORMAT_ADPCM
+};
+
+// ADPCM 模式下每次编码的 PCM 字节数，以及对应的输出缓冲大小
+#define ADPCM_SLICE_BYTES   REC_CHUNK_BYTES
+#define ADPCM_SLICE_OUT     (((ADPCM_SLICE_BYTES / 2) / ADPCM_BLOCK_SAMPLES + 1) * ADPCM_BLOCK_BYTES)
+
+// 每次从录音缓冲取多少段连续内存 (分散 / 聚集发送)
+#define REC_SPAN_BATCH      4
+
+// 回复 JSON：帧长超过上限直接拒收 (不读、不分配)；过滤后的内容放进固定大小的文档池，
+// 每个事务开始时清空复用
+#define REPLY_JSON_MAX      4096
+#define REPLY_JSON_ARENA    1024
 
 class AppServer {
 public:
     void init(const char* ip, int port);
     
-    // 上传录音并等待回复 (阻塞执行)
-    void chatWithServer();
+    // 以下两个函数接手 rec 的引用 (来自 NetMessage.data)，用完即归还
+
+    // 边录边传：录音开始时调用，分片到达即发送，录音结束后直接等待回复 (阻塞执行)
+    void streamChatWithServer(Recording *rec);
+
+    // 无法上传时 (如 WiFi 断开) 等本次录音结束后直接归还
+    void discardStream(Recording *rec);
+
+    void setUploadFormat(UploadFormat fmt);
+
+    // 长连接维护 (网络任务空闲时调用)：重连、心跳
+    void poll();
+    // WiFi 掉线时关闭长连接
+    void disconnect();
+    void printStats();
 
 private:
-    const char* server_ip;
-    int server_port;
+    // 读取服务器回复：JSON 帧 + 音频帧，结束时收尾本次事务
+    void handleReply();
+    // 按握手协商的能力调整上传格式
+    void applyCaps();
+
+    // 到服务器的长连接，对话事务都在这条连接上依次进行
+    ServerSession session;
+
+    // 上传录音 (AUDIO 帧)：ADPCM 模式先发 ADPCM WAV 头，录音数据边发边编码，最后补发不完整的块
+    uint32_t beginUpload(uint32_t totalSamples);
+    uint32_t sendRecording(Recording *rec, uint32_t offset, uint32_t len);
+    uint32_t sendSpan(const uint8_t *data, uint32_t len);
+    uint32_t endUpload();
+
+    // 从连接上直接解析回复 JSON，只保留设备用到的字段
+    bool parseReply(uint32_t len);
+
+    // 回复 JSON 的文档池和过滤器 (只在网络任务中使用，放在这里不占任务栈)
+    StaticJsonDocument<REPLY_JSON_ARENA> replyDoc;
+    StaticJsonDocument<128> replyFilter;
+
+    UploadFormat upload_format = UPLOAD_FORMAT_PCM;
+    AdpcmEncoder encoder;
+    uint8_t adpcm_buf[ADPCM_SLICE_OUT];
 };
 
 extern AppServer MyServer;
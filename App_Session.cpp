@@ -0,0 +1,374 @@
+#include "App_Session.h"
+
+static const char *frameName(uint8_t type) {
+    switch (type) {
+        case FRAME_HELLO:       return "HELLO";
+        case FRAME_PING:        return "PING";
+        case FRAME_PONG:        return "PONG";
+        case FRAME_AUDIO:       return "AUDIO";
+        case FRAME_AUDIO_END:   return "AUDIO_END";
+        case FRAME_CANCEL:      return "CANCEL";
+        case FRAME_JSON:        return "JSON";
+        case FRAME_CACHE:       return "CACHE";
+        case FRAME_REPLY_START: return "REPLY_START";
+        case FRAME_REPLY_AUDIO: return "REPLY_AUDIO";
+        case FRAME_REPLY_END:   return "REPLY_END";
+        case FRAME_ACK:         return "ACK";
+        case FRAME_ERROR:       return "ERROR";
+        default:                return "?";
+    }
+}
+
+void ServerSession::init(const char *host, uint16_t port) {
+    _host = host;
+    _port = port;
+    _retryAt = millis();
+}
+
+bool ServerSession::connect() {
+    uint32_t t0 = millis();
+    Serial.printf("[Session] Connecting to %s:%d...\n", _host, _port);
+    bool ok = _client.connect(_host, _port, SESSION_CONNECT_TIMEOUT_MS);
+    if (ok) {
+        _client.setNoDelay(true);
+        _rx.reset();
+        ok = handshake();
+        if (!ok) _client.stop();
+    }
+    if (!ok) {
+        _stats.connect_failures++;
+        _retryAt = millis() + _backoff;
+        Serial.printf("[Session] Connect failed, retry in %u ms\n", _backoff);
+        _backoff = (_backoff * 2 > SESSION_BACKOFF_MAX_MS) ? SESSION_BACKOFF_MAX_MS : _backoff * 2;
+        return false;
+    }
+    _open = true;
+    _busy = false;
+    _backoff = SESSION_BACKOFF_MIN_MS;
+    _lastActivity = millis();
+    _stats.connects++;
+    _stats.last_connect_ms = millis() - t0;
+    Serial.printf("[Session] Connected in %u ms, caps=0x%x\n", _stats.last_connect_ms, _caps);
+    return true;
+}
+
+// 交换 HELLO (事务号 0)：payload = 协议版本 + 能力位，只启用双方都支持的能力
+bool ServerSession::handshake() {
+    uint8_t hello[5];
+    hello[0] = FRAME_PROTOCOL_VERSION;
+    FrameEncoder::putU32(hello + 1, SESSION_LOCAL_CAPS);
+    if (!sendFrame(FRAME_HELLO, 0, hello, sizeof(hello))) return false;
+
+    FrameHeader h;
+    if (!recvHeader(&h, SESSION_HELLO_TIMEOUT_MS)) return false;
+    if (h.type != FRAME_HELLO || h.txn != 0 || h.len < sizeof(hello) ||
+        readPayload(hello, sizeof(hello), SESSION_HELLO_TIMEOUT_MS) != sizeof(hello)) {
+        Serial.printf("[Session] Bad handshake (%s, %u bytes)\n", frameName(h.type), h.len);
+        return false;
+    }
+    if (hello[0] != FRAME_PROTOCOL_VERSION) {
+        Serial.printf("[Session] Protocol version mismatch: server %d, device %d\n", hello[0], FRAME_PROTOCOL_VERSION);
+        return false;
+    }
+    // 新版本服务器可能在 HELLO 后面追加字段，不认识的部分跳过
+    if (!skipPayload(SESSION_HELLO_TIMEOUT_MS)) return false;
+    _caps = SESSION_LOCAL_CAPS & FrameEncoder::getU32(hello + 1);
+    return true;
+}
+
+void ServerSession::drop(const char *reason) {
+    Serial.printf("[Session] Closing connection: %s\n", reason);
+    _client.stop();
+    _open = false;
+    _busy = false;
+    _stats.drops++;
+    // 连接本身是好的 (只是流状态不对或对端关了)，下一次 poll 立即重连
+    _retryAt = millis();
+}
+
+void ServerSession::close() {
+    if (!_open) return;
+    _client.stop();
+    _open = false;
+    _busy = false;
+}
+
+void ServerSession::nextTxn() {
+    _txn++;
+    if (_txn == 0) _txn = 1;    // 0 留给握手
+    _replyDone = false;
+}
+
+bool ServerSession::begin() {
+    if (_busy) drop("previous transaction not finished");
+    if (_open && !_client.connected()) drop("closed by peer");
+    // 事务之间连接上不应该有数据，有就说明上一次的应答没读干净
+    if (_open && _client.available() > 0) drop("stray bytes between transactions");
+
+    // 用户发起的事务不受重连退避限制
+    bool reused = _open;
+    if (!_open && !connect()) return false;
+
+    nextTxn();
+    _busy = true;
+    _stats.transactions++;
+    if (reused) _stats.reused++;
+    return true;
+}
+
+void ServerSession::end(bool ok) {
+    if (!_busy) return;
+    // 最后一帧的 payload 调用方不关心时在这里读掉，连接才能接着用
+    if (ok && _rx.hasHeader()) ok = skipPayload(SESSION_READ_TIMEOUT_MS);
+    _busy = false;
+    _lastActivity = millis();
+    if (!ok) drop("transaction aborted");
+}
+
+bool ServerSession::sendFrame(uint8_t type, uint16_t txn, const uint8_t *data, uint32_t len) {
+    bool ok;
+    FrameEncoder::encodeHeader(_txBuf, type, txn, len);
+    if (len <= FRAME_TX_CHUNK) {
+        // 小帧和帧头拼在一起，一个 TCP 段发出去
+        if (len > 0) memcpy(_txBuf + FRAME_HEADER_LEN, data, len);
+        ok = (_client.write(_txBuf, FRAME_HEADER_LEN + len) == FRAME_HEADER_LEN + len);
+    } else {
+        ok = (_client.write(_txBuf, FRAME_HEADER_LEN) == FRAME_HEADER_LEN) &&
+             (_client.write(data, len) == len);
+    }
+    if (!ok) {
+        Serial.printf("[Session] Write %s failed\n", frameName(type));
+        return false;
+    }
+    _stats.frames_tx++;
+    return true;
+}
+
+bool ServerSession::send(uint8_t type, const uint8_t *data, uint32_t len) {
+    return sendFrame(type, _txn, data, len);
+}
+
+uint32_t ServerSession::sendAudio(const uint8_t *data, uint32_t len) {
+    uint32_t sent = 0;
+    while (len > 0) {
+        uint32_t n = (len > FRAME_TX_CHUNK) ? FRAME_TX_CHUNK : len;
+        if (!sendFrame(FRAME_AUDIO, _txn, data, n)) break;
+        sent += n;
+        data += n;
+        len -= n;
+    }
+    return sent;
+}
+
+bool ServerSession::waitReadable(uint32_t timeoutMs) {
+    int fd = _client.fd();
+    if (fd < 0) return false;
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(fd, &rfds);
+    struct timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    return select(fd + 1, &rfds, NULL, NULL, &tv) > 0;
+}
+
+uint32_t ServerSession::readAtLeast(uint8_t *buf, uint32_t minLen, uint32_t maxLen, uint32_t timeoutMs) {
+    uint32_t got = 0;
+    uint32_t t0 = millis();
+    while (got < maxLen) {
+        // WiFiClient 自己有接收缓冲，先取里面的，取空了才需要等 socket
+        int avail = _client.available();
+        if (avail > 0) {
+            uint32_t n = maxLen - got;
+            if (n > (uint32_t)avail) n = avail;
+            int r = _client.read(buf + got, n);
+            if (r > 0) {
+                got += r;
+                continue;
+            }
+        }
+        if (got >= minLen) break;
+        uint32_t waited = millis() - t0;
+        if (waited >= timeoutMs || !waitReadable(timeoutMs - waited)) {
+            _stats.timeouts++;
+            break;
+        }
+        // 可读却没有数据：对端关闭或出错
+        if (_client.available() <= 0 && !_client.connected()) break;
+    }
+    return got;
+}
+
+uint32_t ServerSession::readPayload(uint8_t *buf, uint32_t len, uint32_t timeoutMs, bool waitAll) {
+    if (!_rx.hasHeader()) return 0;
+    if (len > _rx.payloadLeft()) len = _rx.payloadLeft();
+    uint32_t got = readAtLeast(buf, waitAll ? len : (len > 0 ? 1 : 0), len, timeoutMs);
+    _rx.consume(got);
+    return got;
+}
+
+bool ServerSession::skipPayload(uint32_t timeoutMs) {
+    uint8_t scratch[128];
+    while (_rx.hasHeader()) {
+        if (readPayload(scratch, sizeof(scratch), timeoutMs) == 0) return false;
+    }
+    return true;
+}
+
+bool ServerSession::recvHeader(FrameHeader *h, uint32_t timeoutMs) {
+    if (_rx.failed() || !skipPayload(timeoutMs)) return false;
+
+    uint8_t buf[FRAME_HEADER_LEN];
+    uint32_t got = readAtLeast(buf, sizeof(buf), sizeof(buf), timeoutMs);
+    if (got < sizeof(buf)) {
+        Serial.printf("[Session] No frame for txn %d (%u of %d header bytes)\n", _txn, got, FRAME_HEADER_LEN);
+        return false;
+    }
+    _rx.feed(buf, sizeof(buf));
+    if (_rx.failed()) {
+        Serial.println("[Session] Frame length out of range, stream is corrupt");
+        return false;
+    }
+    *h = _rx.header();
+    if (h->len == 0) _rx.consume(0);
+    _stats.frames_rx++;
+
+    if (h->type != FRAME_HELLO && h->txn != _txn) {
+        Serial.printf("[Session] %s for txn %d, expected %d\n", frameName(h->type), h->txn, _txn);
+        return false;
+    }
+    if (h->type == FRAME_REPLY_END || h->type == FRAME_ERROR) _replyDone = true;
+    if (h->type == FRAME_ERROR) {
+        // 错误码 (2 字节) + 说明文字，只用来打日志
+        uint8_t msg[66];
+        uint32_t n = readPayload(msg, sizeof(msg) - 1, SESSION_READ_TIMEOUT_MS);
+        msg[n] = 0;
+        Serial.printf("[Session] Server error %d: %s\n", n >= 2 ? (msg[0] << 8) | msg[1] : -1,
+                      n > 2 ? (const char *)msg + 2 : "");
+    }
+    return true;
+}
+
+bool ServerSession::finishReply(uint32_t timeoutMs) {
+    FrameHeader h;
+    while (!_replyDone) {
+        if (!recvHeader(&h, timeoutMs)) return false;
+    }
+    return true;
+}
+
+void ServerSession::cancel() {
+    if (!_busy) return;
+    bool ok = _replyDone;
+    if (!ok && (_caps & FRAME_CAP_CANCEL) && _client.connected()) {
+        // 服务器停止发送并以 REPLY_END 收尾，路上已经发出的帧在这里丢掉
+        _stats.cancels++;
+        ok = send(FRAME_CANCEL) && finishReply(SESSION_CANCEL_TIMEOUT_MS);
+    }
+    end(ok);
+}
+
+bool ServerSession::postEvent(const char *json) {
+    if (!begin()) return false;
+
+    FrameHeader h;
+    bool ok = send(FRAME_JSON, (const uint8_t *)json, strlen(json)) && recvHeader(&h, SESSION_PING_TIMEOUT_MS);
+    bool acked = ok && h.type == FRAME_ACK;
+    end(ok && (acked || h.type == FRAME_ERROR));
+    return acked;
+}
+
+void ServerSession::poll() {
+    if (_host == NULL || _busy) return;
+
+    if (_open && !_client.connected()) drop("closed by peer");
+    if (!_open) {
+        // 后台重连：下一次说话时连接通常已经就绪
+        if ((int32_t)(millis() - _retryAt) >= 0) connect();
+        return;
+    }
+    if (_client.available() > 0) {
+        drop("unexpected data while idle");
+        return;
+    }
+    if (millis() - _lastActivity < SESSION_HEARTBEAT_MS) return;
+
+    // 心跳单独占一个事务号，不计入事务统计
+    uint32_t t0 = millis();
+    nextTxn();
+    _busy = true;
+    FrameHeader h;
+    bool ok = send(FRAME_PING) && recvHeader(&h, SESSION_PING_TIMEOUT_MS) && h.type == FRAME_PONG;
+    _stats.pings++;
+    if (ok) _stats.last_rtt_ms = millis() - t0;
+    end(ok);
+}
+
+void ServerSession::printStats() {
+    Serial.printf("[Session] %s, txn=%d, caps=0x%x, transactions=%u (reused %u, cancelled %u), connects=%u (failed %u, last %u ms), drops=%u\n",
+                  isOpen() ? "open" : "closed", _txn, _caps, _stats.transactions, _stats.reused, _stats.cancels,
+                  _stats.connects, _stats.connect_failures, _stats.last_connect_ms, _stats.drops);
+    Serial.printf("[Session] Frames tx=%u rx=%u, read timeouts=%u, heartbeats=%u, last RTT %u ms\n",
+                  _stats.frames_tx, _stats.frames_rx, _stats.timeouts, _stats.pings, _stats.last_rtt_ms);
+}
+
+bool FramePayloadStream::fill() {
+    if (_pos < _len) return true;
+    if (_timedOut || _session->payloadLeft() == 0) return false;
+    uint32_t elapsed = millis() - _start;
+    uint32_t n = (elapsed < _timeout) ? _session->readPayload(_buf, sizeof(_buf), _timeout - elapsed, false) : 0;
+    if (n == 0) {
+        _timedOut = true;
+        return false;
+    }
+    _pos = 0;
+    _len = n;
+    return true;
+}
+
+size_t FramePayloadStream::readBytes(char *buffer, size_t length) {
+    size_t got = 0;
+    while (got < length && fill()) {
+        size_t n = _len - _pos;
+        if (n > length - got) n = length - got;
+        memcpy(buffer + got, _buf + _pos, n);
+        _pos += n;
+        got += n;
+    }
+    return got;
+}
+
+int FramePayloadStream::read() {
+    return fill() ? _buf[_pos++] : -1;
+}
+
+int FramePayloadStream::peek() {
+    return fill() ? _buf[_pos] : -1;
+}
+
+size_t FrameAudioStream::readBytes(char *buffer, size_t length) {
+    uint32_t got = 0;
+    while (got == 0 && !_done) {
+        if (_session->payloadLeft() == 0) {
+            // 当前帧读完，取下一帧：REPLY_AUDIO 接着读，其他帧 (REPLY_END / ERROR) 说明音频结束
+            FrameHeader h;
+            if (_session->replyDone() || !_session->recvHeader(&h, SESSION_AUDIO_TIMEOUT_MS) ||
+                h.type != FRAME_REPLY_AUDIO) {
+                _done = true;
+            }
+            continue;
+        }
+        got = _session->readPayload((uint8_t *)buffer, length, SESSION_AUDIO_TIMEOUT_MS, false);
+        if (got == 0) _done = true;
+    }
+    return got;
+}
+
+int FrameAudioStream::available() {
+    return _done ? 0 : _session->payloadLeft();
+}
+
+int FrameAudioStream::read() {
+    uint8_t c;
+    return (readBytes((char *)&c, 1) == 1) ? c : -1;
+}
@@ -0,0 +1,178 @@
+#ifndef APP_SESSION_H
+#define APP_SESSION_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include "App_Frame.h"
+
+// 本机支持的能力，握手时告诉服务器
+#define SESSION_LOCAL_CAPS  (FRAME_CAP_ADPCM_UPLOAD | FRAME_CAP_ADPCM_REPLY | FRAME_CAP_REPLY_CACHE | FRAME_CAP_CANCEL)
+
+// 各阶段的期限 (读操作从开始等算起，到点没收齐就放弃)。等待用 select 挂在 socket 上，
+// 数据一到网络任务立即被唤醒，不再按固定间隔轮询
+#define SESSION_CONNECT_TIMEOUT_MS      3000    // TCP 建连 (WiFiClient 内部非阻塞 connect + select)
+#define SESSION_HELLO_TIMEOUT_MS        3000
+#define SESSION_FIRST_BYTE_TIMEOUT_MS   10000   // 上传结束到回复第一帧 (识别 + 大模型)
+#define SESSION_JSON_TIMEOUT_MS         2000    // JSON 帧头到 payload 收齐
+#define SESSION_AUDIO_START_TIMEOUT_MS  5000    // 缓存应答到 REPLY_START (TTS 首包)
+#define SESSION_AUDIO_TIMEOUT_MS        3000    // 回复音频两次到达之间
+#define SESSION_HEARTBEAT_MS            20000   // 空闲这么久发一次心跳，中间的 NAT / 代理不会把连接回收
+#define SESSION_PING_TIMEOUT_MS         3000
+#define SESSION_READ_TIMEOUT_MS         3000    // 其他短读 (帧内剩余 payload、ACK)
+#define SESSION_CANCEL_TIMEOUT_MS       1000    // CANCEL 后等服务器收尾的时间，超时就断开
+#define SESSION_BACKOFF_MIN_MS      1000    // 重连失败后的退避时间，每次翻倍
+#define SESSION_BACKOFF_MAX_MS      30000
+
+/**
+ * 到 AI 服务器的长连接会话 (分帧协议见 App_Frame.h)
+ * 连接建立一次后在多次交互间复用，省掉每句话的 TCP 握手 (4G 下 RTT 60~150ms)。
+ * 建连后先交换 HELLO 核对版本、协商能力；每个事务的帧带事务号，应答对不上就断开重连。
+ * 空闲时定期心跳；连接断开或应答出错时关掉，按退避时间在后台重连，
+ * 下一次交互时通常已经连好了。只在网络任务中使用，不加锁。
+ */
+class ServerSession {
+public:
+    struct Stats {
+        uint32_t connects;          // 成功建立连接 (含握手) 的次数
+        uint32_t connect_failures;
+        uint32_t reused;            // 直接复用已有连接的事务数
+        uint32_t transactions;
+        uint32_t drops;             // 因出错 / 超时 / 对端关闭而断开的次数
+        uint32_t pings;
+        uint32_t cancels;           // 发出的 CANCEL
+        uint32_t frames_tx;
+        uint32_t frames_rx;
+        uint32_t timeouts;          // 读操作超过阶段期限
+        uint32_t last_connect_ms;   // 最近一次建连 + 握手耗时
+        uint32_t last_rtt_ms;       // 最近一次心跳往返
+    };
+
+    void init(const char *host, uint16_t port);
+
+    // 开始一个事务：需要时先建连握手，分配新的事务号；失败返回 false
+    bool begin();
+    // 结束事务：ok 为 false 表示流里可能还有没读完的帧，直接断开，稍后重连
+    void end(bool ok);
+
+    // 发一帧 (当前事务)，帧头和 payload 合并成一次写出
+    bool send(uint8_t type, const uint8_t *data = NULL, uint32_t len = 0);
+    // 发录音数据：按 FRAME_TX_CHUNK 切成多个 AUDIO 帧，返回发出的 payload 字节数
+    uint32_t sendAudio(const uint8_t *data, uint32_t len);
+
+    // 读下一帧的帧头 (上一帧 payload 没读完的部分先丢掉)；超时、断开、事务号不符返回 false
+    bool recvHeader(FrameHeader *h, uint32_t timeoutMs);
+    // 读当前帧 payload，最多 len 字节，返回实际读到的字节数 (不足说明超时或断开)；
+    // waitAll 为 false 时只要读到数据就返回，不等凑满 (边收边播)
+    uint32_t readPayload(uint8_t *buf, uint32_t len, uint32_t timeoutMs, bool waitAll = true);
+    uint32_t payloadLeft() const { return _rx.payloadLeft(); }
+
+    // 读到 REPLY_END (或 ERROR) 为止，中间的帧全部丢弃；用于播完后收尾
+    bool finishReply(uint32_t timeoutMs);
+    bool replyDone() const { return _replyDone; }
+    // 放弃当前事务：对端支持时发 CANCEL 并等待收尾以保留连接，否则断开。会结束事务
+    void cancel();
+
+    // 上报一段 JSON (短事务，等服务器 ACK)
+    bool postEvent(const char *json);
+
+    // 网络任务空闲时调用：断线重连 (带退避)、空闲心跳、检查对端是否已关闭
+    void poll();
+
+    // 主动断开 (如 WiFi 掉线)
+    void close();
+
+    bool isOpen() { return _open && _client.connected(); }
+    bool connected() { return _client.connected(); }
+    WiFiClient *client() { return &_client; }
+    // 双方都支持的能力位 (握手后有效)
+    uint32_t caps() const { return _caps; }
+    uint16_t currentTxn() const { return _txn; }
+    Stats getStats() const { return _stats; }
+    void printStats();
+
+private:
+    bool connect();
+    bool handshake();
+    void drop(const char *reason);
+    void nextTxn();
+    // 从连接上读 minLen ~ maxLen 字节 (timeoutMs 内凑够 minLen)，返回实际读到的字节数
+    uint32_t readAtLeast(uint8_t *buf, uint32_t minLen, uint32_t maxLen, uint32_t timeoutMs);
+    // 阻塞在 socket 上直到可读 (有数据或对端关闭) 或超时
+    bool waitReadable(uint32_t timeoutMs);
+    // 丢掉当前帧剩余的 payload
+    bool skipPayload(uint32_t timeoutMs);
+    bool sendFrame(uint8_t type, uint16_t txn, const uint8_t *data, uint32_t len);
+
+    WiFiClient _client;
+    const char *_host = NULL;
+    uint16_t _port = 0;
+    bool _open = false;
+    bool _busy = false;             // 事务进行中
+    uint16_t _txn = 0;              // 0 只用于握手
+    uint32_t _caps = 0;
+    bool _replyDone = false;        // 本事务已读到 REPLY_END / ERROR
+
+    FrameDecoder _rx;
+    uint8_t _txBuf[FRAME_HEADER_LEN + FRAME_TX_CHUNK];
+
+    uint32_t _lastActivity = 0;     // 最近一次事务结束的时间
+    uint32_t _retryAt = 0;          // 下一次允许重连的时间
+    uint32_t _backoff = SESSION_BACKOFF_MIN_MS;
+    Stats _stats = {};
+};
+
+/**
+ * 当前帧剩余的 payload 作为 Stream 读出 (给 ArduinoJson 直接从连接上解析)。
+ * 小块预读减少逐字节读 socket 的开销；整帧必须在 timeoutMs 内收完，到点按数据结束处理
+ */
+#define FRAME_PAYLOAD_STREAM_BUF    64
+
+class FramePayloadStream : public Stream {
+public:
+    FramePayloadStream(ServerSession *session, uint32_t timeoutMs)
+        : _session(session), _timeout(timeoutMs), _start(millis()) {}
+
+    // payload 没读完就超时或断开了
+    bool timedOut() const { return _timedOut; }
+
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+    int available() { return (_len - _pos) + _session->payloadLeft(); }
+    int read();
+    int peek();
+    size_t write(uint8_t) { return 0; }
+
+private:
+    bool fill();
+
+    ServerSession *_session;
+    uint32_t _timeout;
+    uint32_t _start;
+    bool _timedOut = false;
+    uint8_t _buf[FRAME_PAYLOAD_STREAM_BUF];
+    uint8_t _pos = 0;
+    uint8_t _len = 0;
+};
+
+/**
+ * 把当前事务的 REPLY_AUDIO 帧拼成连续字节流，交给播放器按普通 Stream 读取；
+ * 读到 REPLY_END 或其他帧时结束 (readBytes 返回 0)
+ */
+class FrameAudioStream : public Stream {
+public:
+    explicit FrameAudioStream(ServerSession *session) : _session(session) {}
+
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+    int available();
+    int read();
+    int peek() { return -1; }
+    size_t write(uint8_t) { return 0; }
+
+private:
+    ServerSession *_session;
+    bool _done = false;
+};
+
+#endif
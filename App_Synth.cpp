@@ -0,0 +1,116 @@
+#include "App_Synth.h"
+#include <math.h>
+
+// 多出一个点用于插值时的回绕
+static int16_t sineTable[SYNTH_TABLE_SIZE + 1];
+static bool sineTableReady = false;
+
+void ToneSynth::begin(uint32_t sampleRate, int16_t amplitude) {
+    _rate = sampleRate;
+    _amp = amplitude;
+    _active = false;
+
+    // 波表只在启动时计算一次
+    if (!sineTableReady) {
+        for (int i = 0; i < SYNTH_TABLE_SIZE; i++) {
+            sineTable[i] = (int16_t)lrintf(32767.0f * sinf(2.0f * (float)PI * i / SYNTH_TABLE_SIZE));
+        }
+        sineTable[SYNTH_TABLE_SIZE] = sineTable[0];
+        sineTableReady = true;
+    }
+}
+
+void ToneSynth::play(uint16_t freq, uint16_t ms) {
+    ToneStep step = { freq, ms };
+    play(&step, 1);
+}
+
+void ToneSynth::play(const ToneStep *steps, uint8_t count) {
+    if (count > SYNTH_MAX_STEPS) count = SYNTH_MAX_STEPS;
+    memcpy(_steps, steps, count * sizeof(ToneStep));
+    _count = count;
+    _index = 0;
+    _active = (count > 0);
+    if (_active) loadStep();
+}
+
+void ToneSynth::stop() {
+    _active = false;
+}
+
+void ToneSynth::loadStep() {
+    const ToneStep &step = _steps[_index];
+
+    _len = (uint32_t)step.ms * _rate / 1000;
+    _pos = 0;
+    _phase = 0;
+    _phaseInc = (uint32_t)(((uint64_t)step.freq << 32) / _rate);
+    _silent = (step.freq == 0);
+
+    // 音符很短时按比例缩短起音 / 释音
+    uint32_t attack = SYNTH_ATTACK_MS * _rate / 1000;
+    uint32_t release = SYNTH_RELEASE_MS * _rate / 1000;
+    if (attack > _len / 2) attack = _len / 2;
+    if (release > _len / 2) release = _len / 2;
+    _releaseAt = _len - release;
+
+    if (attack > 0) {
+        _env = 0;
+        _envInc = 32767 / attack;
+    } else {
+        _env = 32767;
+        _envInc = 0;
+    }
+}
+
+int ToneSynth::render(int16_t *out, int frames) {
+    int n = 0;
+
+    while (n < frames && _active) {
+        // 当前音符结束，切换到序列中的下一个
+        if (_pos >= _len) {
+            if (++_index >= _count) {
+                _active = false;
+                break;
+            }
+            loadStep();
+            continue;
+        }
+
+        uint32_t todo = _len - _pos;
+        if (todo > (uint32_t)(frames - n)) todo = frames - n;
+
+        if (_silent) {
+            memset(out + n, 0, todo * sizeof(int16_t));
+            _pos += todo;
+            n += todo;
+            continue;
+        }
+
+        for (uint32_t i = 0; i < todo; i++) {
+            // 进入释音段：按剩余采样数线性衰减到 0
+            if (_pos == _releaseAt && _len > _releaseAt) {
+                _envInc = -(_env / (int32_t)(_len - _releaseAt));
+                if (_envInc == 0) _envInc = -1;
+            }
+
+            // 查表 + 线性插值：高 8 位为表索引，其后 15 位为插值系数
+            uint32_t idx = _phase >> (32 - SYNTH_TABLE_BITS);
+            int32_t frac = (_phase >> (32 - SYNTH_TABLE_BITS - 15)) & 0x7FFF;
+            int32_t a = sineTable[idx];
+            int32_t b = sineTable[idx + 1];
+            int32_t s = a + (((b - a) * frac) >> 15);
+
+            s = (s * _amp) >> 15;
+            out[n++] = (int16_t)((s * _env) >> 15);
+
+            _phase += _phaseInc;
+            _pos++;
+
+            _env += _envInc;
+            if (_env > 32767) { _env = 32767; _envInc = 0; }
+            if (_env < 0) _env = 0;
+        }
+    }
+    return n;
+}
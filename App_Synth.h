@@ -0,0 +1,63 @@
+#ifndef APP_SYNTH_H
+#define APP_SYNTH_H
+
+#include <Arduino.h>
+
+// 正弦波表：256 点 (Q15)，查表 + 线性插值，不再逐样本调用 sin()
+#define SYNTH_TABLE_BITS    8
+#define SYNTH_TABLE_SIZE    (1 << SYNTH_TABLE_BITS)
+
+// 起音 / 释音时长 (ms)，消除提示音开始和结束时的爆音
+#define SYNTH_ATTACK_MS     5
+#define SYNTH_RELEASE_MS    10
+
+// 一个提示音序列 (earcon) 最多包含的音符数
+#define SYNTH_MAX_STEPS     8
+
+// 提示音序列中的一个音符，freq = 0 表示静音间隔
+struct ToneStep {
+    uint16_t freq;      // Hz
+    uint16_t ms;        // 时长
+};
+
+/**
+ * 定点波表合成器 (相位累加器)
+ * 输出单声道 16bit PCM，采样率与 I2S 一致，由音频引擎按块调用 render()。
+ */
+class ToneSynth {
+public:
+    void begin(uint32_t sampleRate, int16_t amplitude);
+
+    // 单音
+    void play(uint16_t freq, uint16_t ms);
+    // 多音序列，steps 会被拷贝，调用方无需保留
+    void play(const ToneStep *steps, uint8_t count);
+    void stop();
+
+    bool isActive() const { return _active; }
+
+    // 生成最多 frames 个采样，返回实际生成数 (序列结束后返回值可能小于 frames)
+    int render(int16_t *out, int frames);
+
+private:
+    void loadStep();
+
+    uint32_t _rate = 16000;
+    int32_t _amp = 10000;           // 峰值幅度
+
+    ToneStep _steps[SYNTH_MAX_STEPS];
+    uint8_t _count = 0;
+    uint8_t _index = 0;
+    bool _active = false;
+
+    uint32_t _phase = 0;            // 相位累加器，一周期 = 2^32
+    uint32_t _phaseInc = 0;
+    uint32_t _pos = 0;              // 当前音符已输出的采样数
+    uint32_t _len = 0;              // 当前音符总采样数
+    uint32_t _releaseAt = 0;        // 从这个位置开始释音
+    int32_t _env = 0;               // 包络增益 Q15
+    int32_t _envInc = 0;            // 每个采样的包络增量 (Q15)
+    bool _silent = false;           // 当前音符为静音间隔
+};
+
+#endif
@@ -1,6 +1,9 @@
 #include "App_Sys.h"
 #include <math.h> 
 #include "Pin_Config.h"
+#include "App_Audio.h"
+#include "App_Server.h"
+#include "App_Command.h"
 AppSys MySys;
 
 // ---  NTC 热敏电阻参数 ---
@@ -74,6 +77,43 @@ void AppSys::scanLoop() {
     }
 }
 
+void AppSys::scanSerial() {
+    while (Serial.available()) {
+        char c = Serial.read();
+        if (c == '\r' || c == '\n') {
+            if (_cmdLen > 0) {
+                _cmdBuf[_cmdLen] = 0;
+                handleCommand(_cmdBuf);
+                _cmdLen = 0;
+            }
+        } else if (_cmdLen < sizeof(_cmdBuf) - 1) {
+            _cmdBuf[_cmdLen++] = c;
+        }
+    }
+}
+
+void AppSys::handleCommand(char *line) {
+    if (strcmp(line, "audio") == 0) {
+        MyAudio.printPipelineStats();
+        MyAudio.printCmdStats();
+        MyAudio.printCodecStats();
+    } else if (strcmp(line, "audio reset") == 0) {
+        MyAudio.resetPipelineStats();
+        Serial.println("[Sys] Audio stats reset.");
+    } else if (strcmp(line, "net") == 0) {
+        MyServer.printStats();
+    } else if (strcmp(line, "cmd") == 0) {
+        MyCommand.printStats();
+    } else if (strncmp(line, "audio dma ", 10) == 0) {
+        const char *name = line + 10;
+        if (strcmp(name, "low") == 0) MyAudio.setDmaProfile(AUDIO_DMA_LOW_LATENCY);
+        else if (strcmp(name, "balanced") == 0) MyAudio.setDmaProfile(AUDIO_DMA_BALANCED);
+        else if (strcmp(name, "throughput") == 0) MyAudio.setDmaProfile(AUDIO_DMA_THROUGHPUT);
+        else Serial.println("[Sys] Usage: audio dma <low|balanced|throughput>");
+    } else {
+        Serial.printf("[Sys] Unknown command: %s\n", line);
+    }
+}
 
 KeyAction AppSys::getKeyAction() {
     static bool lastState = HIGH; 
@@ -17,13 +17,13 @@ enum KeyAction {
 // --- [新增] 网络任务消息结构 ---
 enum NetEventType {
     NET_EVENT_NONE,
-    NET_EVENT_UPLOAD_AUDIO  // 上传录音指令
+    NET_EVENT_STREAM_AUDIO  // 边录边传指令 (录音开始时发出)
 };
 
 struct NetMessage {
     NetEventType type;
-    uint8_t* data;      // 指向音频数据的指针
-    size_t len;         // 数据长度
+    uint8_t* data;      // 音频事件：Recording* (所有权随消息转交，接收方用完 releaseRecording)
+    size_t len;         // data 指向对象的大小
 };
 
 // 声明全局队列句柄，方便其他文件 extern 引用
@@ -41,11 +41,21 @@ public:
     // 专门给 RTOS 任务调用的轮询函数 (修复了这里缺失实现的问题)
     void scanLoop(); 
 
+    // 串口调试命令 (一行一条)：
+    //   audio            打印音频管线统计和指令派发延迟
+    //   audio reset      清零音频管线统计
+    //   audio dma <low|balanced|throughput>  切换 I2S DMA 配置档
+    void scanSerial();
+
     // 获取按键动作 (状态机)
     KeyAction getKeyAction();
 
 private:
     // 内部变量
+    void handleCommand(char *line);
+
+    char _cmdBuf[48];
+    uint8_t _cmdLen = 0;
     uint32_t _pressStartTime = 0;
     bool _isLongPressHandled = false;
 };
@@ -4,7 +4,7 @@
 #include "App_Audio.h"   
 #include "App_WiFi.h"    
 #include <time.h> 
-#include "App_433.h"
+#include "App_Command.h"
 #include <ArduinoJson.h> 
 #include "App_Sys.h"
 
@@ -24,29 +24,19 @@ void AppUILogic::handleAICommand(String jsonString) {
         return;
     }
 
-    const char* object = doc["object"]; // "AirConditioner", "CarDoor"
-    const char* action = doc["action"]; // "Open", "SetTemp"
-    int value = doc["value"];           // 24
-
-    Serial.printf("[AI] 执行指令: 对象=%s, 动作=%s, 值=%d\n", object, action, value);
+    // 2. 和服务器回复的 control 走同一张路由表 (对象字段叫 object)
+    MyCommand.dispatchJson(doc.as<JsonVariant>(), "object");
+}
 
-    // 2. 根据指令执行动作
-    if (strcmp(object, "CarDoor") == 0) {
-        if (strcmp(action, "Open") == 0) {
-            // 调用 433 发送开锁信号
-            // 假设 My433 有一个 send 函数，或者你在这里直接控制 GPIO
-            // My433.send(0x123456, 24); 
-            Serial.println(">>> 正在通过 433MHz 打开车门...");
-        }
-    } 
-    else if (strcmp(object, "AirConditioner") == 0) {
-        // 这里可能需要发送红外或者其他逻辑
-        Serial.printf(">>> 设置空调温度为: %d\n", value);
-    }
+static void recordDoneThunk(Recording *rec, uint32_t len, void *ctx) {
+    ((AppUILogic *)ctx)->onRecordDone(rec, len);
 }
 
 void AppUILogic::init() {
     _uiGroup = lv_group_create();
+
+    // 录音控制不等音频任务：停止后的收尾结果经回调通知
+    MyAudio.setRecordCallback(recordDoneThunk, this);
     
     lv_group_add_obj(_uiGroup, ui_ButtonAI);
     lv_group_add_obj(_uiGroup, ui_ButtonLink);
@@ -61,7 +51,7 @@ void AppUILogic::init() {
 
 void AppUILogic::toggleFocus() {
     lv_group_focus_next(_uiGroup);
-    MyAudio.playToneAsync(600, 50); 
+    MyAudio.playEarcon(EARCON_FOCUS);
 }
 
 void AppUILogic::showQRCode() {
@@ -86,6 +76,14 @@ void AppUILogic::executeLongPressStart() {
 
     if (focusedObj == ui_ButtonAI) {
         Serial.println("[UI] LongPress: Start Recording");
+
+        // 先拿录音对象：前几轮还在上传 / 等回复把录音池占满时，不切换界面，只提示出错
+        Recording *rec = MyAudio.startRecording();
+        if (rec == NULL) {
+            Serial.println("[UI] 录音池已满，忽略本次长按");
+            MyAudio.playEarcon(EARCON_ERROR);
+            return;
+        }
         
         // --- 视觉交互修改 START ---
         // 隐藏常规组件
@@ -102,8 +100,11 @@ void AppUILogic::executeLongPressStart() {
         }
         // --- 视觉交互修改 END ---
 
-        MyAudio.startRecording();
         _isRecording = true;
+        _rec = rec;
+
+        // 录音一开始就通知网络任务建立连接，边录边传 (上一轮还没结束时消息在队列里排队，录音照常进行)
+        streamAudioToPC(rec);
 
     } else if (focusedObj == ui_ButtonLink) {
         Serial.println("[UI] LongPress: Go to QR");
@@ -113,33 +114,39 @@ void AppUILogic::executeLongPressStart() {
     }
 }
 
-void AppUILogic::sendAudioToPC() {
-    // 1. 检查数据有效性
-    if (MyAudio.record_buffer == NULL || MyAudio.record_data_len == 0) {
-        Serial.println("[UI] 无录音数据，取消上传");
-        return;
-    }
-
-    // 2. 组装消息 (不拷贝数据，只发送事件类型)
+void AppUILogic::streamAudioToPC(Recording *rec) {
     NetMessage msg;
-    msg.type = NET_EVENT_UPLOAD_AUDIO; // 复用这个枚举，但含义变为 "Start TCP Chat"
-    msg.len  = 0; 
-    msg.data = NULL; // 不需要拷贝数据，AppServer 直接读取 MyAudio 全局缓冲区
+    msg.type = NET_EVENT_STREAM_AUDIO; // 网络任务从录音对象中按分片取数据
+    msg.data = (uint8_t *)rec;
+    msg.len  = sizeof(Recording);
 
-    // 3. 发送给网络任务
     if (xQueueSend(NetQueue_Handle, &msg, 0) == pdTRUE) {
-        Serial.println("[UI] 已通知网络任务开始处理录音");
+        Serial.println("[UI] 已通知网络任务开始流式上传");
     } else {
+        // 没人接手：录音照常结束，段在录音任务放掉它那份引用时回收
         Serial.println("[UI] 错误：网络队列已满");
+        MyAudio.releaseRecording(rec);
     }
 }
 
+// 用户说话打断了回复 (网络任务调用)：录音已由音频侧开始，静音后自动结束；
+// 这里只切换提示文字并把这段录音交给新一轮流式上传
+void AppUILogic::startBargeInTurn(Recording *rec) {
+    if (xSemaphoreTake(xGuiSemaphore, portMAX_DELAY) == pdTRUE) {
+        if(ui_LabelAIStatus) lv_label_set_text(ui_LabelAIStatus, "Listening...");
+        xSemaphoreGive(xGuiSemaphore);
+    }
+    streamAudioToPC(rec);
+}
+
 // 3. 修改长按结束：更新文本为“处理中”，但不恢复 UI
 void AppUILogic::executeLongPressEnd() {
     if (_isRecording) {
         Serial.println("[UI] Released: Stop Recording");
-        MyAudio.stopRecording();
+        // 只投递停止指令，不在持有 GUI 锁时等录音任务收尾
+        MyAudio.stopRecording(_rec);
         _isRecording = false;
+        _rec = nullptr;
 
         // --- 视觉交互修改 START ---
         // 不要在这里把红色背景改回去，因为按钮已经隐藏了
@@ -150,10 +157,28 @@ void AppUILogic::executeLongPressEnd() {
             lv_label_set_text(ui_LabelAIStatus, "Processing..."); // "处理中..."
         }
         // --- 视觉交互修改 END ---
-        
-        sendAudioToPC(); 
+
+        // 录音数据已在录制过程中流式上传，最后一个分片由录音任务发出，这里无需再通知网络任务
     }
 }
+void AppUILogic::onRecordDone(Recording *rec, uint32_t len) {
+    Serial.printf("[UI] Recording finished: %d bytes\n", len);
+    _doneRec = rec;
+}
+
+// 按键还按着录音就结束了 (VAD 静音自动停止 / 录音段用尽)：提前切到“处理中”，
+// 松手时不再重复停止。调用方持有 GUI 锁
+void AppUILogic::applyRecordDone() {
+    Recording *rec = _doneRec;
+    _doneRec = nullptr;
+    if (!_isRecording || rec != _rec) return;
+
+    Serial.println("[UI] Recording ended before release");
+    _isRecording = false;
+    _rec = nullptr;
+    if(ui_LabelAIStatus) lv_label_set_text(ui_LabelAIStatus, "Processing...");
+}
+
 void AppUILogic::finishAIState() {
     if (xSemaphoreTake(xGuiSemaphore, portMAX_DELAY) == pdTRUE) {
         Serial.println("[UI] AI Process Finished. Restoring UI.");
@@ -236,6 +261,11 @@ void AppUILogic::handleInput(KeyAction action) {
 }
 
 void AppUILogic::loop() {
+    if (_doneRec != nullptr && xSemaphoreTake(xGuiSemaphore, 0) == pdTRUE) {
+        applyRecordDone();
+        xSemaphoreGive(xGuiSemaphore);
+    }
+
     static uint32_t lastUpdate = 0;
     if (millis() - lastUpdate > 1000) {
         lastUpdate = millis();
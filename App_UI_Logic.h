@@ -6,6 +6,9 @@
 #include "ui.h"       // SquareLine 导出的 UI 文件
 #include "App_Sys.h"  // 按键动作定义 (KEY_SHORT_PRESS 等)
 #include <HTTPClient.h>
+
+struct Recording;   // App_Audio.h
+
 class AppUILogic {
 public:
     void init();
@@ -14,9 +17,14 @@ public:
     // 处理输入 (被 Task_UI 调用)
     void handleInput(KeyAction action);
     void finishAIState();
-    void sendAudioToPC();                    
+    // 以下把录音对象经 NetMessage 交给网络任务 (连同这份引用)
+    void streamAudioToPC(Recording *rec);
+    void startBargeInTurn(Recording *rec);
     void handleAICommand(String jsonString);
 
+    // 录音结束通知 (在录音任务中调用，只记下结果，界面在 loop() 里更新)
+    void onRecordDone(Recording *rec, uint32_t len);
+
 private:
     void updateStatusBar();
     void showQRCode();
@@ -24,10 +32,13 @@ private:
     
     void executeLongPressStart();
     void executeLongPressEnd();
+    void applyRecordDone();
 
     lv_group_t* _uiGroup; 
     lv_obj_t* _qrObj = nullptr; // 用于存放动态生成的二维码对象
     bool _isRecording = false;
+    Recording *_rec = nullptr;              // 本轮长按开始的录音 (只用来比对，引用已交给网络任务)
+    Recording *volatile _doneRec = nullptr; // 录音任务报告已结束的录音
 };
 
 extern AppUILogic MyUILogic;
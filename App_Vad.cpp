@@ -0,0 +1,83 @@
+#include "App_Vad.h"
+
+// 能量门限 (相对噪声底的倍数)：浊音 x4 (约 6dB)；高过零率的清音 x2 (约 3dB)
+#define VAD_VOICED_RATIO    4
+#define VAD_UNVOICED_RATIO  2
+// 清音的过零率范围 (每帧过零次数)
+#define VAD_ZC_MIN          (VAD_FRAME_SAMPLES / 5)
+#define VAD_ZC_MAX          (VAD_FRAME_SAMPLES * 3 / 4)
+// 绝对能量下限 (均方值)，低于此值一律视为静音
+#define VAD_MIN_ENERGY      200
+// 初始噪声底上限，防止一按下就开口时把语音当成噪声底
+#define VAD_INIT_NOISE_MAX  1000
+#define VAD_MIN_NOISE       50
+
+void VoiceDetector::begin(uint32_t sampleRate) {
+    _rate = sampleRate;
+    reset();
+}
+
+void VoiceDetector::reset() {
+    _energyAcc = 0;
+    _zc = 0;
+    _n = 0;
+    _prev = 0;
+    _noise = 0;
+    _noiseInit = false;
+    _onset = 0;
+    _detected = false;
+    _silence = 0;
+}
+
+void VoiceDetector::process(const int16_t *pcm, int samples) {
+    for (int i = 0; i < samples; i++) {
+        int32_t x = pcm[i];
+        _energyAcc += (uint32_t)(x * x);
+        if ((x ^ _prev) < 0) _zc++;
+        _prev = (int16_t)x;
+
+        if (++_n == VAD_FRAME_SAMPLES) {
+            decideFrame();
+            _energyAcc = 0;
+            _zc = 0;
+            _n = 0;
+        }
+    }
+}
+
+void VoiceDetector::decideFrame() {
+    uint32_t energy = (uint32_t)(_energyAcc / VAD_FRAME_SAMPLES);
+
+    if (!_noiseInit) {
+        _noise = energy < VAD_INIT_NOISE_MAX ? energy : VAD_INIT_NOISE_MAX;
+        if (_noise < VAD_MIN_NOISE) _noise = VAD_MIN_NOISE;
+        _noiseInit = true;
+    }
+
+    bool speech = false;
+    if (energy > VAD_MIN_ENERGY) {
+        if (energy > _noise * VAD_VOICED_RATIO) {
+            speech = true;
+        } else if (energy > _noise * VAD_UNVOICED_RATIO && _zc > VAD_ZC_MIN && _zc < VAD_ZC_MAX) {
+            speech = true;
+        }
+    }
+
+    if (speech) {
+        if (_onset < VAD_ONSET_FRAMES) _onset++;
+        if (_onset >= VAD_ONSET_FRAMES) _detected = true;
+        _silence = 0;
+        return;
+    }
+
+    _onset = 0;
+    if (_detected) _silence += VAD_FRAME_SAMPLES;
+
+    // 噪声底跟踪：下降快 (1/4)，上升慢 (1/64)，语音帧不参与
+    if (energy < _noise) {
+        _noise -= (_noise - energy) >> 2;
+    } else {
+        _noise += (energy - _noise) >> 6;
+    }
+    if (_noise < VAD_MIN_NOISE) _noise = VAD_MIN_NOISE;
+}
@@ -0,0 +1,51 @@
+#ifndef APP_VAD_H
+#define APP_VAD_H
+
+#include <Arduino.h>
+
+// 分帧长度：256 采样 (16ms @16k)，一次 I2S 读取 (512 帧) 正好两帧
+#define VAD_FRAME_SAMPLES   256
+// 连续多少个语音帧才确认开口 (过滤按键声等短促噪声)
+#define VAD_ONSET_FRAMES    3
+
+/**
+ * 轻量定点语音活动检测 (能量 + 过零率)
+ * 逐段喂入 PCM，内部按帧判决；噪声底自适应跟踪，只在非语音帧更新。
+ */
+class VoiceDetector {
+public:
+    void begin(uint32_t sampleRate);
+    void reset();
+
+    // 喂入一段采样 (长度任意，内部拼帧)
+    void process(const int16_t *pcm, int samples);
+
+    // 本次录音中是否已经确认开口
+    bool speechDetected() const { return _detected; }
+
+    // 最后一个语音帧之后的静音采样数 (未开口时为 0)
+    uint32_t silenceSamples() const { return _silence; }
+    uint32_t silenceMs() const { return _silence * 1000 / _rate; }
+
+    // 调试用：当前噪声底 (均方值)
+    uint32_t noiseFloor() const { return _noise; }
+
+private:
+    void decideFrame();
+
+    uint32_t _rate = 16000;
+
+    // 当前帧的累加量
+    uint64_t _energyAcc = 0;
+    uint16_t _zc = 0;
+    uint16_t _n = 0;
+    int16_t _prev = 0;
+
+    uint32_t _noise = 0;        // 噪声底 (每采样均方值)
+    bool _noiseInit = false;
+    uint8_t _onset = 0;         // 连续语音帧计数
+    bool _detected = false;
+    uint32_t _silence = 0;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "App_Wav.h"
+
+static inline uint16_t rd16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static inline uint32_t rd32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+// KSDATAFORMAT_SUBTYPE_xxx 的公共部分：GUID 前 2 字节是格式码，后 14 字节固定
+static const uint8_t ksSubtypeTail[14] = {
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+};
+
+void WavParser::reset() {
+    _state = WAV_NEED_MORE;
+    _fmt = {};
+    _haveFmt = false;
+    _skip = 0;
+    _consumed = 0;
+    expect(STAGE_RIFF, 12);
+}
+
+void WavParser::expect(Stage stage, size_t bytes) {
+    _stage = stage;
+    _have = 0;
+    _need = bytes;
+}
+
+size_t WavParser::feed(const uint8_t *data, size_t len) {
+    size_t used = 0;
+
+    while (used < len && _state == WAV_NEED_MORE) {
+        if (_stage == STAGE_SKIP) {
+            uint32_t n = len - used;
+            if (n > _skip) n = _skip;
+            _skip -= n;
+            used += n;
+            if (_skip == 0) expect(STAGE_CHUNK, 8);
+            continue;
+        }
+
+        size_t n = _need - _have;
+        if (n > len - used) n = len - used;
+        memcpy(_field + _have, data + used, n);
+        _have += n;
+        used += n;
+        if (_have == _need) onField();
+    }
+
+    _consumed += used;
+    return used;
+}
+
+// 一个定长字段收集完毕
+void WavParser::onField() {
+    switch (_stage) {
+        case STAGE_RIFF:
+            if (memcmp(_field, "RIFF", 4) != 0 || memcmp(_field + 8, "WAVE", 4) != 0) {
+                _state = WAV_ERROR;
+                return;
+            }
+            expect(STAGE_CHUNK, 8);
+            break;
+
+        case STAGE_CHUNK: {
+            uint32_t size = rd32(_field + 4);
+            uint32_t padded = size + (size & 1); // RIFF 块按 2 字节对齐
+
+            if (memcmp(_field, "data", 4) == 0) {
+                _fmt.dataBytes = size;
+                _state = _haveFmt ? WAV_READY : WAV_ERROR;
+            } else if (memcmp(_field, "fmt ", 4) == 0 && size >= WAV_FMT_MIN_BYTES) {
+                _skip = padded - WAV_FMT_MIN_BYTES;
+                expect(STAGE_FMT, WAV_FMT_MIN_BYTES);
+            } else {
+                _skip = padded;
+                expect(STAGE_SKIP, 0);
+                if (_skip == 0) expect(STAGE_CHUNK, 8);
+            }
+            break;
+        }
+
+        case STAGE_FMT:
+            _fmt.format = rd16(_field);
+            _fmt.channels = rd16(_field + 2);
+            _fmt.sampleRate = rd32(_field + 4);
+            _fmt.blockAlign = rd16(_field + 12);
+            _fmt.bits = rd16(_field + 14);
+            _haveFmt = true;
+            if (_fmt.format == WAV_FORMAT_EXTENSIBLE && _skip >= WAV_FMT_EXT_BYTES) {
+                _skip -= WAV_FMT_EXT_BYTES;
+                expect(STAGE_FMT_EXT, WAV_FMT_EXT_BYTES);
+            } else if (_skip > 0) {
+                expect(STAGE_SKIP, 0);
+            } else {
+                expect(STAGE_CHUNK, 8);
+            }
+            break;
+
+        case STAGE_FMT_EXT:
+            // 子格式 GUID 在扩展的第 8 字节起；只有标准 KSDATAFORMAT GUID 才换成对应的格式码
+            // (如浮点 3 会被 isPlayable 拒掉)，其他厂商 GUID 保持 EXTENSIBLE，同样拒绝
+            if (memcmp(_field + 10, ksSubtypeTail, sizeof(ksSubtypeTail)) == 0) {
+                _fmt.format = rd16(_field + 8);
+            }
+            if (_skip > 0) expect(STAGE_SKIP, 0);
+            else expect(STAGE_CHUNK, 8);
+            break;
+
+        default:
+            break;
+    }
+}
+
+bool WavParser::isPlayable() const {
+    if (_state != WAV_READY) return false;
+    if (_fmt.sampleRate < 4000 || _fmt.sampleRate > 96000) return false;
+    if (_fmt.format == WAV_FORMAT_IMA_ADPCM) {
+        // 流式解码不缓存整块，块大小只需容得下 4 字节块头
+        return _fmt.channels == 1 && _fmt.bits == 4 && _fmt.blockAlign > 4;
+    }
+    if (_fmt.format != WAV_FORMAT_PCM) return false;
+    if (_fmt.channels < 1 || _fmt.channels > 2) return false;
+    if (_fmt.bits != 8 && _fmt.bits != 16) return false;
+    return _fmt.blockAlign == _fmt.channels * _fmt.bits / 8;
+}
@@ -0,0 +1,69 @@
+#ifndef APP_WAV_H
+#define APP_WAV_H
+
+#include <Arduino.h>
+
+// fmt 块中只关心前 16 字节，扩展部分 (cbSize 之后) 直接跳过；
+// WAVE_FORMAT_EXTENSIBLE 另外读 24 字节扩展 (cbSize、有效位数、声道掩码、子格式 GUID)
+#define WAV_FMT_MIN_BYTES   16
+#define WAV_FMT_EXT_BYTES   24
+
+#define WAV_FORMAT_PCM          0x0001
+#define WAV_FORMAT_IMA_ADPCM    0x0011
+#define WAV_FORMAT_EXTENSIBLE   0xFFFE
+
+enum WavParseState {
+    WAV_NEED_MORE,      // 头还没读完
+    WAV_READY,          // 已定位到 data 块，后续字节即为音频数据
+    WAV_ERROR           // 不是 WAV，或缺少 fmt 块
+};
+
+struct WavFormat {
+    uint16_t format;        // 1 = PCM；EXTENSIBLE 换成子格式 GUID 里的格式码，认不出的子格式保持 EXTENSIBLE
+    uint16_t channels;
+    uint32_t sampleRate;
+    uint16_t blockAlign;    // 每帧字节数
+    uint16_t bits;
+    uint32_t dataBytes;     // data 块长度 (流式 TTS 可能填 0 或 0xFFFFFFFF)
+};
+
+/**
+ * 增量 RIFF/WAV 头解析器
+ * 可以按任意大小的分片喂入 (哪怕一次一个字节)，遇到 LIST / fact 等无关块直接跳过，
+ * 解析到 data 块头后停止消耗，剩下的字节交给调用方当作音频数据处理。
+ */
+class WavParser {
+public:
+    void reset();
+
+    // 喂入数据，返回本次消耗的字节数；state() 变为 WAV_READY 后不再消耗
+    size_t feed(const uint8_t *data, size_t len);
+
+    WavParseState state() const { return _state; }
+    const WavFormat &format() const { return _fmt; }
+
+    // 已消耗的头部字节数 (含跳过的块)
+    uint32_t headerBytes() const { return _consumed; }
+
+    // 格式是否能被播放 (16/8bit PCM 单声道或立体声，或单声道 IMA-ADPCM)
+    bool isPlayable() const;
+
+private:
+    enum Stage { STAGE_RIFF, STAGE_CHUNK, STAGE_FMT, STAGE_FMT_EXT, STAGE_SKIP };
+
+    void onField();
+    void expect(Stage stage, size_t bytes);
+
+    WavParseState _state = WAV_NEED_MORE;
+    Stage _stage = STAGE_RIFF;
+    WavFormat _fmt = {};
+    bool _haveFmt = false;
+
+    uint8_t _field[WAV_FMT_EXT_BYTES];  // 正在收集的定长字段 (RIFF 头 12 / 块头 8 / fmt 16 / 扩展 24)
+    size_t _have = 0;
+    size_t _need = 0;
+    uint32_t _skip = 0;                 // 还要跳过的字节数
+    uint32_t _consumed = 0;
+};
+
+#endif
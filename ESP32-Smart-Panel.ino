@@ -27,6 +27,8 @@
 #include "App_IR.h"
 #include "App_433.h"
 #include "App_Server.h"
+#include "App_ReplyCache.h"
+#include "App_Command.h"
 
 // volatile 确保多任务访问时的数据一致性
 volatile float g_SystemTemp = 0.0f;
@@ -48,11 +50,11 @@ TaskHandle_t TaskNet_Handle   = NULL;
 TaskHandle_t TaskIR_Handle    = NULL;
 TaskHandle_t Task433_Handle   = NULL; 
 
-// --- 音频指令结构体 ---
-struct AudioMsg {
-    uint8_t type; // 0:Beep, 1:StartRec, 2:StopRec
-    int param;
-};
+// --- 音频指令结构体 AudioMsg 见 App_Audio.h (0:Beep, 1:StartRec, 2:StopRec, 3:Stream, 4:Earcon, 5:Alert, 6:Gain, 7:BargeIn, 8:DmaProfile) ---
+
+// 音频任务使用静态栈，常驻运行，不走堆分配
+static StackType_t TaskAudio_Stack[4096];
+static StaticTask_t TaskAudio_TCB;
 // =================================================================
 // [Core 1] 任务 1: UI 界面 (LVGL 渲染 & 逻辑)
 // =================================================================
@@ -107,6 +109,9 @@ void TaskSys_Code(void *pvParameters) {
         // 3. 执行系统级扫描 (日志等)
         MySys.scanLoop();
 
+        // 4. 串口调试命令 (音频统计 / DMA 配置档切换)
+        MySys.scanSerial();
+
         vTaskDelay(pdMS_TO_TICKS(20));
     }
 }
@@ -117,23 +122,9 @@ void TaskSys_Code(void *pvParameters) {
 void TaskAudio_Code(void *pvParameters) {
     MyAudio.init();
 
-    AudioMsg msg;
-
-    for(;;) {
-        if (xQueueReceive(AudioQueue_Handle, &msg, portMAX_DELAY) == pdTRUE) {
-            switch (msg.type) {
-                case 0:
-                    MyAudio.playToneAsync(800, 200);
-                    break;
-                case 1:
-                    MyAudio.startRecording();
-                    break;
-                case 2:
-                    MyAudio.stopRecording();
-                    break;
-            }
-        }
-    }
+    // 常驻音频引擎：消费 AudioQueue 中的提示音 / 录音启停 / 回复播放指令，
+    // 提示音和回复播放都在本任务内完成，不再为每个指令临时创建任务
+    MyAudio.runEngine();
 }
 
 
@@ -151,34 +142,43 @@ void TaskNet_Code(void *pvParameters) {
     // 确保服务器IP设置正确 (对应你 Python 电脑的 IP)
     MyServer.init("192.168.1.53", 8080); 
 
+    // 常用回复的本地缓存 (首次启动会格式化 LittleFS 分区)
+    MyReplyCache.begin();
+    // 设备控制路由表 (优先用 LittleFS 上的表，分区已在上面挂载)
+    MyCommand.begin();
+
     NetMessage msg;
 
     for(;;) {
         // 等待 UI 任务发来的信号
         if (xQueueReceive(NetQueue_Handle, &msg, pdMS_TO_TICKS(100)) == pdTRUE) {
+            // 音频事件的 data 是录音对象，下面的处理函数接手并负责归还
+            Recording *rec = (Recording *)msg.data;
             
-            if (msg.type == NET_EVENT_UPLOAD_AUDIO) {
-                Serial.println("[Net] 收到交互请求，开始连接 Python 服务器...");
-                
-                // 确保 WiFi 已连接
+            if (msg.type == NET_EVENT_STREAM_AUDIO) {
+                Serial.println("[Net] 收到流式交互请求，边录边传...");
+
                 if (MyWiFi.isConnected()) {
-                    // 直接调用 AppServer 的阻塞式处理函数
-                    // 因为 TaskNet 优先级低，阻塞这里不会影响 UI 流畅度
-                    MyServer.chatWithServer(); 
+                    // 阻塞到回复播完；TaskNet 优先级低，阻塞这里不会影响 UI 流畅度
+                    MyServer.streamChatWithServer(rec);
                 } else {
                     Serial.println("[Net] WiFi 未连接，无法上传");
-                    // 恢复 UI 状态，否则会一直显示“处理中”
+                    // 等录音结束后再恢复 UI，否则松手后会一直显示“处理中”
+                    MyServer.discardStream(rec);
                     MyUILogic.finishAIState();
                 }
             }
-            
-            // 如果 msg.data 不为空（兼容旧代码），记得释放
-            if (msg.data != NULL) {
-                free(msg.data);
-                msg.data = NULL;
-            }
         }
         
+        // 服务器长连接：断线重连、空闲心跳 (WiFi 掉线时先关掉，等 WiFi 恢复再连)
+        if (MyWiFi.isConnected()) {
+            MyServer.poll();
+        } else {
+            MyServer.disconnect();
+        }
+        // 回复缓存的命中记录 (LRU / 统计) 在空闲时写回
+        MyReplyCache.flushIdle();
+
         // 简单的自动重连机制
         static uint32_t lastCheck = 0;
         if (millis() - lastCheck > 5000) {
@@ -248,7 +248,7 @@ void setup() {
     MyWiFi.connect("HC-2G", "aa888888");
     MyServer.init("192.168.1.53", 8080);
     // 1. 创建队列
-    AudioQueue_Handle = xQueueCreate(5, sizeof(AudioMsg));
+    AudioQueue_Handle = xQueueCreate(8, sizeof(AudioMsg));
     KeyQueue_Handle   = xQueueCreate(10, sizeof(KeyAction));
     IRQueue_Handle    = xQueueCreate(5,  sizeof(IREvent)); 
     NetQueue_Handle   = xQueueCreate(3, sizeof(NetMessage));
@@ -265,7 +265,7 @@ void setup() {
     
     // [Core 0] 协议/驱动层 (负责处理外设通讯)
     // 音频优先级必须最高 (4)，否则 WiFi 传输时声音会破音
-    xTaskCreatePinnedToCore(TaskAudio_Code, "Audio",   4096, NULL, 4, &TaskAudio_Handle, 0);
+    TaskAudio_Handle = xTaskCreateStaticPinnedToCore(TaskAudio_Code, "Audio", 4096, NULL, 4, TaskAudio_Stack, &TaskAudio_TCB, 0);
     // 网络任务栈要大 (8192)，WiFi 库吃内存
     xTaskCreatePinnedToCore(TaskNet_Code,   "Net",     8192, NULL, 1, &TaskNet_Handle,   0);
     xTaskCreatePinnedToCore(TaskIR_Code,    "IR",      4096, NULL, 1, &TaskIR_Handle,    0);
@@ -0,0 +1,90 @@
+// 麦克风前端：每 10 ms 帧的周期数 (各级组合)，以及降噪 / AGC 的效果
+#include "host/host.h"
+#include "App_MicDsp.h"
+
+#define RATE        16000
+#define SAMPLES     (RATE * 6)
+#define NS_DELAY    256     // 降噪的固定延迟
+
+static int16_t sig[SAMPLES], clean[SAMPLES], buf[SAMPLES];
+static MicFrontEnd fe;
+
+static double rms(const int16_t *x, int n) {
+    double p = 0;
+    for (int i = 0; i < n; i++) p += (double)x[i] * x[i];
+    return sqrt(p / n);
+}
+
+static double delayedSnr(const int16_t *ref, const int16_t *x, int n, int delay) {
+    double p = 0, e = 0;
+    for (int i = 0; i < n - delay; i++) {
+        double r = ref[i], y = x[i + delay];
+        p += r * r;
+        e += (y - r) * (y - r);
+    }
+    return 10 * log10(p / e);
+}
+
+static void run(uint8_t stages, int block) {
+    fe.begin(RATE);
+    fe.setStages(stages);
+    memcpy(buf, sig, sizeof(buf));
+    for (int i = 0; i < SAMPLES; i += block) fe.process(buf + i, (SAMPLES - i < block) ? SAMPLES - i : block);
+}
+
+int main() {
+    // 2 s 噪声 + 3 s 低电平调幅谐波 (RMS ~250) + 1 s 噪声；全程白噪声 RMS ~150，外加直流 800
+    for (int i = 0; i < SAMPLES; i++) {
+        double t = (double)i / RATE, sp = 0;
+        if (t >= 2 && t < 5) {
+            double env = 0.5 + 0.5 * sin(2 * PI * 3 * t);
+            sp = env * (400 * sin(2 * PI * 200 * t) + 300 * sin(2 * PI * 400 * t + 1) + 200 * sin(2 * PI * 800 * t + 2));
+        }
+        double nz = ((int)(testRand() % 2001) - 1000) * 0.26;
+        clean[i] = (int16_t)sp;
+        sig[i] = (int16_t)(sp + nz + 800);
+    }
+
+    run(MIC_DSP_HPF | MIC_DSP_NS, 512);
+    double noiseOut = rms(buf + RATE * 5 + 4000, 8000);
+    double snrIn = 20 * log10(rms(clean + 2 * RATE, 3 * RATE) / 150.0);
+    double snrOut = delayedSnr(clean + 2 * RATE, buf + 2 * RATE, 3 * RATE, NS_DELAY);
+    CHECK(noiseOut < 150 / 2.0, "noise RMS %.0f after NS", noiseOut);
+    CHECK(snrOut > snrIn + 5, "speech SNR %.1f -> %.1f dB", snrIn, snrOut);
+    printf("NS: noise RMS 150 -> %.0f (%.1f dB), speech SNR %.1f -> %.1f dB\n",
+           noiseOut, 20 * log10(noiseOut / 150.0), snrIn, snrOut);
+
+    run(MIC_DSP_ALL, 512);
+    double quiet = rms(clean + 3 * RATE, RATE), raised = rms(buf + 3 * RATE, RATE);
+    CHECK(raised > quiet * 3, "AGC raised quiet speech RMS %.0f -> %.0f", quiet, raised);
+    printf("AGC: quiet speech RMS %.0f -> %.0f\n", quiet, raised);
+
+    // 响亮输入不削波
+    for (int i = 0; i < RATE; i++) buf[i] = (int16_t)(30000 * sin(2 * PI * 300.0 * i / RATE));
+    fe.begin(RATE);
+    fe.setStages(MIC_DSP_HPF | MIC_DSP_AGC);
+    fe.process(buf, RATE);
+    int peak = 0;
+    for (int i = RATE / 2; i < RATE; i++) if (abs(buf[i]) > peak) peak = abs(buf[i]);
+    CHECK(peak < 32000, "loud input peak %d", peak);
+    printf("AGC: 30000-peak sine -> %d peak\n", peak);
+
+    // 每 10 ms 帧 (160 采样) 的处理时间
+    const char *names[] = { "HPF", "HPF+NS", "HPF+NS+AGC" };
+    const uint8_t stages[] = { MIC_DSP_HPF, MIC_DSP_HPF | MIC_DSP_NS, MIC_DSP_ALL };
+    const int frame = RATE * MIC_AGC_FRAME_MS / 1000;
+    for (int k = 0; k < 3; k++) {
+        uint64_t best = ~0ull;
+        for (int r = 0; r < 30; r++) {
+            fe.begin(RATE);
+            fe.setStages(stages[k]);
+            memcpy(buf, sig, sizeof(buf));
+            uint64_t c0 = cycleCount();
+            for (int i = 0; i + frame <= SAMPLES; i += frame) fe.process(buf + i, frame);
+            uint64_t c = cycleCount() - c0;
+            if (c < best) best = c;
+        }
+        printf("%-11s %7.0f " CYCLE_UNIT " / 10 ms frame\n", names[k], (double)best / (SAMPLES / frame));
+    }
+    return testResult("bench_mic_dsp");
+}
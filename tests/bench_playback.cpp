@@ -0,0 +1,110 @@
+// 回复播放写 I2S 的吞吐：逐采样写 4 字节 (旧) vs 整块展开成立体声后一次写入 (现)
+//
+// 驱动用一个替身代替：每次调用加锁、按 DMA 缓冲 (64 帧) 拷贝、缓冲写满时交给 "DMA"，
+// 和 i2s_write 的结构一致 (真机上加锁和入队是 FreeRTOS 调用，开销比这里的 std::mutex 大)。
+// 结果是主机上的相对数字，用来比较两种写法的调用开销
+#include "host/host.h"
+#include "App_Mixer.h"
+#include <mutex>
+
+#define DMA_BUF_FRAMES  64
+#define DMA_BUF_COUNT   8
+#define READ_BYTES      1024        // 从连接一次读 1KB (同 playStream)
+#define TX_CHUNK_FRAMES 256
+
+class FakeI2s {
+public:
+    size_t write(const void *src, size_t size) {
+        std::lock_guard<std::mutex> guard(_lock);
+        const uint8_t *p = (const uint8_t *)src;
+        size_t left = size;
+        while (left > 0) {
+            size_t n = sizeof(_dma[0]) - _pos;
+            if (n > left) n = left;
+            memcpy(_dma[_buf] + _pos, p, n);
+            _pos += n;
+            p += n;
+            left -= n;
+            if (_pos == sizeof(_dma[0])) {
+                _pos = 0;
+                _buf = (_buf + 1) % DMA_BUF_COUNT;
+                _queued++;
+            }
+        }
+        _calls++;
+        return size;
+    }
+
+    uint64_t calls() const { return _calls; }
+    uint32_t checksum() const { return _dma[0][0] + _dma[DMA_BUF_COUNT - 1][3] + (uint32_t)_queued; }
+
+private:
+    std::mutex _lock;
+    uint8_t _dma[DMA_BUF_COUNT][DMA_BUF_FRAMES * 4];
+    size_t _pos = 0;
+    int _buf = 0;
+    uint64_t _queued = 0;
+    uint64_t _calls = 0;
+};
+
+static FakeI2s i2s;
+
+// 旧写法：每个单声道采样组成一个立体声帧，单独调用一次驱动
+static void playPerSample(const int16_t *src, size_t bytes) {
+    for (size_t off = 0; off < bytes; off += READ_BYTES) {
+        int16_t buf[READ_BYTES / 2];
+        size_t len = bytes - off < READ_BYTES ? bytes - off : READ_BYTES;
+        memcpy(buf, (const uint8_t *)src + off, len);
+        for (size_t i = 0; i < len / 2; i++) {
+            int16_t frame[2] = { buf[i], buf[i] };
+            i2s.write(frame, 4);
+        }
+    }
+}
+
+// 现写法：经混音器整块展开成 L=R 交织，每块调用一次驱动
+static void playBlocks(const int16_t *src, size_t bytes) {
+    static AudioMixer mixer;
+    static int16_t stereo[TX_CHUNK_FRAMES * 2];
+    const size_t blockBytes = TX_CHUNK_FRAMES * 2;
+    for (size_t off = 0; off < bytes; off += blockBytes) {
+        int16_t pcm[TX_CHUNK_FRAMES];
+        size_t len = bytes - off < blockBytes ? bytes - off : blockBytes;
+        memcpy(pcm, (const uint8_t *)src + off, len);
+        mixer.begin();
+        mixer.mix(MIX_VOICE_STREAM, pcm, len / 2);
+        int frames = mixer.output(stereo);
+        i2s.write(stereo, frames * 4);
+    }
+}
+
+static double measure(void (*play)(const int16_t *, size_t), const int16_t *src, size_t bytes, uint64_t *calls) {
+    double best = 0;
+    for (int run = 0; run < 5; run++) {
+        uint64_t c0 = i2s.calls();
+        double t0 = nowSeconds();
+        for (int r = 0; r < 20; r++) play(src, bytes);
+        double rate = 20.0 * bytes / (nowSeconds() - t0);
+        if (rate > best) best = rate;
+        *calls = (i2s.calls() - c0) / 20;
+    }
+    return best;
+}
+
+int main() {
+    // 10 s 的 16 kHz 单声道回复
+    const int samples = 16000 * 10;
+    static int16_t reply[samples];
+    makeVoice(reply, samples, 16000, 8000, 300);
+    const size_t bytes = sizeof(reply);
+
+    uint64_t oldCalls, newCalls;
+    double oldRate = measure(playPerSample, reply, bytes, &oldCalls);
+    double newRate = measure(playBlocks, reply, bytes, &newCalls);
+
+    printf("reply: %zu bytes of 16 kHz mono (%.1f s)\n", bytes, samples / 16000.0);
+    printf("per-sample i2s_write: %8.1f MB/s, %llu driver calls\n", oldRate / 1e6, (unsigned long long)oldCalls);
+    printf("block i2s_write:      %8.1f MB/s, %llu driver calls\n", newRate / 1e6, (unsigned long long)newCalls);
+    printf("speedup %.1fx (checksum %u)\n", newRate / oldRate, i2s.checksum());
+    return 0;
+}
@@ -0,0 +1,50 @@
+// 提示音合成：定点波表 (ToneSynth) vs 旧的逐样本 double sin()，报告每采样周期数
+#include "host/host.h"
+#include "App_Synth.h"
+
+#define RATE    16000
+
+int main() {
+    ToneSynth synth;
+    synth.begin(RATE, 10000);
+    int16_t buf[256];
+    int n;
+
+    // 1 kHz、100 ms 的音在 16 kHz 下正好 1600 个采样
+    synth.play(1000, 100);
+    int total = 0;
+    while ((n = synth.render(buf, 256)) > 0) total += n;
+    CHECK(total == RATE / 10, "100 ms tone rendered %d samples", total);
+
+    // 音高：稳定段的过零次数，1 kHz 每秒 2000 次
+    static int16_t tone[RATE];
+    synth.play(1000, 1000);
+    total = 0;
+    while ((n = synth.render(tone + total, 256)) > 0) total += n;
+    int zc = 0;
+    for (int i = 1000; i < 15000; i++) {
+        if ((tone[i - 1] < 0) != (tone[i] < 0)) zc++;
+    }
+    CHECK(abs(zc - 1750) <= 2, "%d zero crossings in 14000 samples, expected 1750", zc);
+
+    const int reps = 2000;
+    long sink = 0;
+    uint64_t c0 = cycleCount();
+    for (int r = 0; r < reps; r++) {
+        synth.play(800, 1000);
+        while ((n = synth.render(buf, 256)) > 0) sink += buf[n - 1];
+    }
+    double table = (double)(cycleCount() - c0) / (reps * (double)RATE);
+
+    // 旧写法：按 44.1 kHz 逐样本算 double sin()
+    c0 = cycleCount();
+    for (int r = 0; r < reps; r++) {
+        for (int i = 0; i < RATE; i++) buf[i & 255] = (int16_t)(10000 * sin(2 * PI * 800 * i / 44100));
+        sink += buf[5];
+    }
+    double libm = (double)(cycleCount() - c0) / (reps * (double)RATE);
+
+    printf("wavetable:     %6.1f " CYCLE_UNIT "/sample\n", table);
+    printf("double sin():  %6.1f " CYCLE_UNIT "/sample  (%ld)\n", libm, sink);
+    return testResult("bench_synth");
+}
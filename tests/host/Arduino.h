@@ -0,0 +1,45 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// 主机测试用的最小 Arduino 替身：只提供纯 C++ 模块 (编解码 / DSP) 用到的部分
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdarg.h>
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+#define IRAM_ATTR
+
+// PSRAM 和 FreeRTOS 临界区：主机上单线程，直接用堆、临界区为空
+#define ps_malloc(n) malloc(n)
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+
+class HostSerial {
+public:
+    // 测试里默认不输出模块日志，需要时设 verbose
+    bool verbose = false;
+
+    int printf(const char *fmt, ...) {
+        if (!verbose) return 0;
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vprintf(fmt, ap);
+        va_end(ap);
+        return n;
+    }
+    size_t println(const char *s = "") { return verbose ? (size_t)::printf("%s\n", s) : 0; }
+    size_t print(const char *s) { return verbose ? (size_t)::printf("%s", s) : 0; }
+};
+
+extern HostSerial Serial;
+
+#endif
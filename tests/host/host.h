@@ -0,0 +1,73 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+// 主机测试 / 基准的公共部分：检查宏、计时、测试信号
+#include <Arduino.h>
+#include <chrono>
+
+HostSerial Serial;
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        failures++; \
+        ::printf("FAIL %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+        ::printf(__VA_ARGS__); \
+        ::printf("\n"); \
+    } \
+} while (0)
+
+static inline int testResult(const char *name) {
+    ::printf("%s: %s (%d failures)\n", name, failures ? "FAILED" : "OK", failures);
+    return failures ? 1 : 0;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t cycleCount() { return __rdtsc(); }
+#define CYCLE_UNIT "cycles"
+#else
+// 没有周期计数器的平台按纳秒计
+static inline uint64_t cycleCount() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#define CYCLE_UNIT "ns"
+#endif
+
+static inline double nowSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 可复现的伪随机数 (各平台 rand() 不一样)
+static uint32_t testRandState = 12345;
+static inline uint32_t testRand() {
+    testRandState = testRandState * 1664525u + 1013904223u;
+    return testRandState >> 8;
+}
+
+// 语音状测试信号：两个谐波 + 白噪声，幅度按 4 Hz 调制
+static inline void makeVoice(int16_t *out, int n, int rate, double amp, double noise) {
+    for (int i = 0; i < n; i++) {
+        double t = (double)i / rate;
+        double env = 0.6 + 0.4 * sin(2 * PI * 4 * t);
+        double v = amp * env * (0.7 * sin(2 * PI * 300 * t) + 0.3 * sin(2 * PI * 1700 * t));
+        v += noise * (((int)(testRand() % 2001) - 1000) / 1000.0);
+        if (v > 32767) v = 32767;
+        if (v < -32768) v = -32768;
+        out[i] = (int16_t)lrint(v);
+    }
+}
+
+static inline double snrDb(const int16_t *ref, const int16_t *got, int n) {
+    double sig = 0, err = 0;
+    for (int i = 0; i < n; i++) {
+        double e = (double)got[i] - ref[i];
+        sig += (double)ref[i] * ref[i];
+        err += e * e;
+    }
+    return err == 0 ? 200.0 : 10 * log10(sig / err);
+}
+
+#endif
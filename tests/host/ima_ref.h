@@ -0,0 +1,89 @@
+#ifndef IMA_REF_H
+#define IMA_REF_H
+
+// IMA-ADPCM 参考实现 (按 IMA 推荐算法逐字写出，块大小任意)，用来核对 App_Adpcm 的输出
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+static const int refStep[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+static const int refIndexAdjust[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+struct RefIma {
+    int pred = 0;
+    int index = 0;
+
+    int decode(int code) {
+        int step = refStep[index];
+        int vpdiff = step >> 3;
+        if (code & 4) vpdiff += step;
+        if (code & 2) vpdiff += step >> 1;
+        if (code & 1) vpdiff += step >> 2;
+        pred += (code & 8) ? -vpdiff : vpdiff;
+        if (pred > 32767) pred = 32767;
+        if (pred < -32768) pred = -32768;
+        index += refIndexAdjust[code & 7];
+        if (index < 0) index = 0;
+        if (index > 88) index = 88;
+        return pred;
+    }
+
+    int encode(int sample) {
+        int step = refStep[index];
+        int diff = sample - pred;
+        int code = 0;
+        if (diff < 0) { code = 8; diff = -diff; }
+        if (diff >= step) { code |= 4; diff -= step; }
+        if (diff >= (step >> 1)) { code |= 2; diff -= step >> 1; }
+        if (diff >= (step >> 2)) { code |= 1; }
+        decode(code);
+        return code;
+    }
+};
+
+// 编码成 WAV 布局的块 (块头 + 低半字节在前)，最后一块用末尾采样补齐
+static std::vector<uint8_t> refImaEncode(const int16_t *pcm, size_t n, size_t blockAlign) {
+    size_t spb = (blockAlign - 4) * 2 + 1;
+    std::vector<uint8_t> out;
+    RefIma st;
+    for (size_t s0 = 0; s0 < n; s0 += spb) {
+        std::vector<int16_t> blk(pcm + s0, pcm + (s0 + spb < n ? s0 + spb : n));
+        blk.resize(spb, blk.back());
+        st.pred = blk[0];
+        out.push_back((uint8_t)(blk[0] & 0xFF));
+        out.push_back((uint8_t)((blk[0] >> 8) & 0xFF));
+        out.push_back((uint8_t)st.index);
+        out.push_back(0);
+        for (size_t i = 1; i < spb; i += 2) {
+            int lo = st.encode(blk[i]);
+            int hi = st.encode(blk[i + 1]);
+            out.push_back((uint8_t)(lo | (hi << 4)));
+        }
+    }
+    return out;
+}
+
+static std::vector<int16_t> refImaDecode(const uint8_t *data, size_t len, size_t blockAlign) {
+    std::vector<int16_t> out;
+    for (size_t b = 0; b + 4 <= len; b += blockAlign) {
+        size_t end = (b + blockAlign < len) ? b + blockAlign : len;
+        RefIma st;
+        st.pred = (int16_t)(data[b] | (data[b + 1] << 8));
+        st.index = data[b + 2] > 88 ? 88 : data[b + 2];
+        out.push_back((int16_t)st.pred);
+        for (size_t i = b + 4; i < end; i++) {
+            out.push_back((int16_t)st.decode(data[i] & 0x0F));
+            out.push_back((int16_t)st.decode(data[i] >> 4));
+        }
+    }
+    return out;
+}
+
+#endif
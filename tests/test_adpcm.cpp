@@ -0,0 +1,125 @@
+// 上传用 IMA-ADPCM 编码器：分片编码、与参考实现逐字节一致、往返信噪比、WAV 头；附编解码吞吐
+#include "host/host.h"
+#include "host/ima_ref.h"
+#include "App_Adpcm.h"
+
+#define RATE        16000
+#define SAMPLES     (RATE * 5)
+
+static int16_t pcm[SAMPLES];
+static uint8_t oneShot[SAMPLES];
+static uint8_t sliced[SAMPLES];
+static int16_t decoded[SAMPLES + ADPCM_BLOCK_SAMPLES];
+
+static size_t encodeAll(AdpcmEncoder &enc, const int16_t *in, size_t n, size_t slice, uint8_t *out) {
+    enc.reset();
+    size_t len = 0;
+    for (size_t i = 0; i < n; i += slice) {
+        size_t k = (n - i < slice) ? n - i : slice;
+        len += enc.encode(in + i, k, out + len);
+    }
+    return len + enc.flush(out + len);
+}
+
+static void testRoundTrip() {
+    makeVoice(pcm, SAMPLES, RATE, 9000, 300);
+    AdpcmEncoder enc;
+
+    size_t len = encodeAll(enc, pcm, SAMPLES, SAMPLES, oneShot);
+    size_t blocks = (SAMPLES + ADPCM_BLOCK_SAMPLES - 1) / ADPCM_BLOCK_SAMPLES;
+    CHECK(len == blocks * ADPCM_BLOCK_BYTES, "encoded %zu bytes, expected %zu", len, blocks * ADPCM_BLOCK_BYTES);
+    CHECK(enc.totalSamples() == SAMPLES, "totalSamples %u", enc.totalSamples());
+
+    // 录音按任意大小的分片送进来，结果必须与一次性编码相同
+    const size_t slices[] = { 1, 7, 504, 505, 506, 777, 2048 };
+    for (size_t s : slices) {
+        size_t n = encodeAll(enc, pcm, SAMPLES, s, sliced);
+        CHECK(n == len && memcmp(sliced, oneShot, len) == 0, "slice %zu differs from one-shot encode", s);
+    }
+
+    std::vector<uint8_t> ref = refImaEncode(pcm, SAMPLES, ADPCM_BLOCK_BYTES);
+    CHECK(ref.size() == len && memcmp(ref.data(), oneShot, len) == 0, "encoder differs from the reference");
+
+    size_t n = 0;
+    for (size_t b = 0; b < len; b += ADPCM_BLOCK_BYTES) {
+        size_t k = AdpcmDecoder::decodeBlock(oneShot + b, ADPCM_BLOCK_BYTES, decoded + n);
+        CHECK(k == ADPCM_BLOCK_SAMPLES, "block %zu decoded to %zu samples", b / ADPCM_BLOCK_BYTES, k);
+        n += k;
+    }
+    std::vector<int16_t> refPcm = refImaDecode(oneShot, len, ADPCM_BLOCK_BYTES);
+    CHECK(refPcm.size() == n && memcmp(refPcm.data(), decoded, n * 2) == 0, "decoder differs from the reference");
+
+    double snr = snrDb(pcm, decoded, SAMPLES);
+    CHECK(snr > 25.0, "round-trip SNR %.1f dB", snr);
+    printf("round trip: %d -> %zu bytes (%.2f:1), SNR %.1f dB\n", SAMPLES * 2, len, SAMPLES * 2.0 / len, snr);
+}
+
+static void testEdgeSignals() {
+    AdpcmEncoder enc;
+    static int16_t sig[ADPCM_BLOCK_SAMPLES * 4];
+    const int n = ADPCM_BLOCK_SAMPLES * 4;
+
+    // 静音解出来仍是 0
+    memset(sig, 0, sizeof(sig));
+    size_t len = encodeAll(enc, sig, n, n, oneShot);
+    size_t m = 0;
+    for (size_t b = 0; b < len; b += ADPCM_BLOCK_BYTES) m += AdpcmDecoder::decodeBlock(oneShot + b, ADPCM_BLOCK_BYTES, decoded + m);
+    bool silent = true;
+    for (size_t i = 0; i < m; i++) silent &= (decoded[i] == 0);
+    CHECK(silent, "silence did not decode to zeros");
+
+    // 满幅方波：预测值和步长索引都会打到边界
+    for (int i = 0; i < n; i++) sig[i] = ((i / 8) & 1) ? 32767 : -32768;
+    len = encodeAll(enc, sig, n, 100, oneShot);
+    std::vector<uint8_t> ref = refImaEncode(sig, n, ADPCM_BLOCK_BYTES);
+    CHECK(ref.size() == len && memcmp(ref.data(), oneShot, len) == 0, "full-scale square differs from the reference");
+
+    // 不足一块的尾巴用最后一个采样补齐，输出一整块
+    enc.reset();
+    CHECK(enc.encode(pcm, 10, oneShot) == 0, "partial block emitted early");
+    CHECK(enc.flush(oneShot) == ADPCM_BLOCK_BYTES, "flush did not emit a full block");
+    CHECK(enc.flush(oneShot) == 0, "second flush emitted data");
+}
+
+static uint32_t le32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+static uint16_t le16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+
+static void testWavHeader() {
+    uint8_t h[ADPCM_WAV_HEADER_SIZE];
+    AdpcmEncoder::writeWavHeader(h, RATE, 1000);
+    CHECK(memcmp(h, "RIFF", 4) == 0 && memcmp(h + 8, "WAVE", 4) == 0, "bad RIFF tag");
+    CHECK(le16(h + 20) == 0x0011 && le16(h + 22) == 1, "format %04x channels %u", le16(h + 20), le16(h + 22));
+    CHECK(le32(h + 24) == RATE && le16(h + 32) == ADPCM_BLOCK_BYTES, "rate %u blockAlign %u", le32(h + 24), le16(h + 32));
+    CHECK(le16(h + 38) == ADPCM_BLOCK_SAMPLES, "samples per block %u", le16(h + 38));
+    CHECK(le32(h + 48) == 1000, "fact %u", le32(h + 48));
+    CHECK(le32(h + 56) == 2 * ADPCM_BLOCK_BYTES && le32(h + 4) == le32(h + 56) + ADPCM_WAV_HEADER_SIZE - 8,
+          "data %u riff %u", le32(h + 56), le32(h + 4));
+
+    AdpcmEncoder::writeWavHeader(h, RATE, ADPCM_UNKNOWN_LENGTH);
+    CHECK(le32(h + 4) == ADPCM_UNKNOWN_LENGTH && le32(h + 56) == ADPCM_UNKNOWN_LENGTH, "streaming lengths not unknown");
+}
+
+static void benchmark() {
+    AdpcmEncoder enc;
+    uint64_t bestEnc = ~0ull, bestDec = ~0ull;
+    size_t len = 0;
+    for (int r = 0; r < 30; r++) {
+        uint64_t c0 = cycleCount();
+        len = encodeAll(enc, pcm, SAMPLES, 1024, oneShot);
+        uint64_t c1 = cycleCount();
+        for (size_t b = 0, n = 0; b < len; b += ADPCM_BLOCK_BYTES) n += AdpcmDecoder::decodeBlock(oneShot + b, ADPCM_BLOCK_BYTES, decoded + n);
+        uint64_t c2 = cycleCount();
+        if (c1 - c0 < bestEnc) bestEnc = c1 - c0;
+        if (c2 - c1 < bestDec) bestDec = c2 - c1;
+    }
+    printf("encode %.1f " CYCLE_UNIT "/sample, decode %.1f " CYCLE_UNIT "/sample\n",
+           (double)bestEnc / SAMPLES, (double)bestDec / SAMPLES);
+}
+
+int main() {
+    testRoundTrip();
+    testEdgeSignals();
+    testWavHeader();
+    benchmark();
+    return testResult("test_adpcm");
+}
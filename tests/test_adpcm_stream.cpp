@@ -0,0 +1,145 @@
+// 回复流式 IMA-ADPCM 解码：任意分片 (含切在块头中间) 与参考实现逐采样一致、WAV 头 + 数据连续到达；附解码吞吐
+#include "host/host.h"
+#include "host/ima_ref.h"
+#include "App_Adpcm.h"
+#include "App_Wav.h"
+
+#define RATE        16000
+#define SAMPLES     (RATE * 5)
+
+static int16_t pcm[SAMPLES];
+static int16_t out[SAMPLES * 2];
+
+// 按网络读取的习惯随机切片：大多是几百字节，夹杂 1~3 字节的碎片 (块头被拆开)
+static size_t nextSlice() {
+    uint32_t r = testRand();
+    return (r & 3) == 0 ? 1 + (r >> 8) % 3 : 1 + (r >> 8) % 700;
+}
+
+static size_t streamDecode(AdpcmStreamDecoder &dec, const uint8_t *data, size_t len, int16_t *dst) {
+    size_t n = 0;
+    for (size_t i = 0; i < len;) {
+        size_t k = nextSlice();
+        if (k > len - i) k = len - i;
+        n += dec.decode(data + i, k, dst + n);
+        i += k;
+    }
+    return n;
+}
+
+static void testBlockAligns() {
+    makeVoice(pcm, SAMPLES, RATE, 9000, 300);
+    const uint16_t aligns[] = { 256, 512, 1024 };
+    for (uint16_t align : aligns) {
+        std::vector<uint8_t> enc = refImaEncode(pcm, SAMPLES, align);
+        std::vector<int16_t> ref = refImaDecode(enc.data(), enc.size(), align);
+
+        AdpcmStreamDecoder dec;
+        dec.begin(align);
+        size_t n = streamDecode(dec, enc.data(), enc.size(), out);
+        CHECK(n == ref.size(), "blockAlign %u: decoded %zu samples, expected %zu", align, n, ref.size());
+        CHECK(memcmp(out, ref.data(), ref.size() * sizeof(int16_t)) == 0, "blockAlign %u: differs from reference", align);
+        printf("blockAlign %4u: %zu bytes -> %zu samples, SNR %.1f dB\n", align, enc.size(), n, snrDb(pcm, out, SAMPLES));
+    }
+}
+
+// 截断在块中间 (TTS 流提前结束)：已到的部分照常输出
+static void testTruncated() {
+    std::vector<uint8_t> enc = refImaEncode(pcm, SAMPLES, 512);
+    size_t len = 512 * 3 + 2;   // 第四块只到了块头前两个字节
+    std::vector<int16_t> ref = refImaDecode(enc.data(), 512 * 3, 512);
+    AdpcmStreamDecoder dec;
+    dec.begin(512);
+    size_t n = streamDecode(dec, enc.data(), len, out);
+    CHECK(n == ref.size() && memcmp(out, ref.data(), n * sizeof(int16_t)) == 0,
+          "truncated stream: %zu samples, expected %zu", n, ref.size());
+}
+
+static void putLE(std::vector<uint8_t> &b, uint32_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) b.push_back((v >> (8 * i)) & 0xFF);
+}
+
+static void putTag(std::vector<uint8_t> &b, const char *tag) {
+    for (int i = 0; i < 4; i++) b.push_back((uint8_t)tag[i]);
+}
+
+// 服务器发来的整段回复：RIFF + fmt (IMA, cbSize = 2) + fact + LIST + data，按播放路径的做法
+// 先喂给 WavParser，头解析完后剩下的字节交给流式解码器
+static void testWavStream() {
+    const uint16_t align = 1024;
+    const uint16_t spb = (align - 4) * 2 + 1;
+    std::vector<uint8_t> enc = refImaEncode(pcm, SAMPLES, align);
+    std::vector<int16_t> ref = refImaDecode(enc.data(), enc.size(), align);
+
+    std::vector<uint8_t> file;
+    putTag(file, "RIFF"); putLE(file, 0xFFFFFFFF, 4); putTag(file, "WAVE");
+    putTag(file, "fmt "); putLE(file, 20, 4);
+    putLE(file, WAV_FORMAT_IMA_ADPCM, 2); putLE(file, 1, 2); putLE(file, RATE, 4);
+    putLE(file, RATE * align / spb, 4); putLE(file, align, 2); putLE(file, 4, 2);
+    putLE(file, 2, 2); putLE(file, spb, 2);
+    putTag(file, "fact"); putLE(file, 4, 4); putLE(file, SAMPLES, 4);
+    putTag(file, "LIST"); putLE(file, 5, 4);
+    for (int i = 0; i < 6; i++) file.push_back('x');    // 奇数长度块带一个填充字节
+    putTag(file, "data"); putLE(file, enc.size(), 4);
+    size_t header = file.size();
+    for (uint8_t b : enc) file.push_back(b);
+
+    WavParser wav;
+    wav.reset();
+    AdpcmStreamDecoder dec;
+    size_t n = 0;
+    for (size_t i = 0; i < file.size();) {
+        size_t k = nextSlice();
+        if (k > file.size() - i) k = file.size() - i;
+        const uint8_t *p = file.data() + i;
+        size_t left = k;
+        i += k;
+        if (wav.state() == WAV_NEED_MORE) {
+            size_t used = wav.feed(p, left);
+            p += used;
+            left -= used;
+            if (wav.state() != WAV_READY) continue;
+            CHECK(wav.isPlayable(), "IMA-ADPCM mono not playable");
+            dec.begin(wav.format().blockAlign);
+        }
+        n += dec.decode(p, left, out + n);
+    }
+
+    const WavFormat &f = wav.format();
+    CHECK(wav.state() == WAV_READY, "parser state %d", wav.state());
+    CHECK(wav.headerBytes() == header, "header %u bytes, expected %zu", wav.headerBytes(), header);
+    CHECK(f.format == WAV_FORMAT_IMA_ADPCM && f.blockAlign == align && f.sampleRate == RATE,
+          "format %u blockAlign %u rate %u", f.format, f.blockAlign, f.sampleRate);
+    CHECK(n == ref.size() && memcmp(out, ref.data(), n * sizeof(int16_t)) == 0,
+          "WAV stream: %zu samples, expected %zu", n, ref.size());
+}
+
+static void benchmark() {
+    std::vector<uint8_t> enc = refImaEncode(pcm, SAMPLES, 512);
+    AdpcmStreamDecoder dec;
+    uint64_t best = ~0ull;
+    double bestSec = 1e9;
+    for (int r = 0; r < 30; r++) {
+        dec.begin(512);
+        double t0 = nowSeconds();
+        uint64_t c0 = cycleCount();
+        // 播放路径每次最多喂 REPLY_IN_FRAMES / 2 = 128 字节
+        for (size_t i = 0; i < enc.size(); i += 128) {
+            dec.decode(enc.data() + i, (enc.size() - i < 128) ? enc.size() - i : 128, out);
+        }
+        uint64_t c = cycleCount() - c0;
+        double sec = nowSeconds() - t0;
+        if (c < best) best = c;
+        if (sec < bestSec) bestSec = sec;
+    }
+    printf("stream decode %.1f " CYCLE_UNIT "/sample, %.1f MB/s in, %.0fx realtime\n",
+           (double)best / SAMPLES, enc.size() / bestSec / 1e6, SAMPLES / (double)RATE / bestSec);
+}
+
+int main() {
+    testBlockAligns();
+    testTruncated();
+    testWavStream();
+    benchmark();
+    return testResult("adpcm_stream");
+}
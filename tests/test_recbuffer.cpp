@@ -0,0 +1,163 @@
+// 分段录音缓冲：按需取段、分散 / 聚集读出、段数上限、段池复用、跨段搬移、接手预录音环形区
+#include "host/host.h"
+#include "App_RecBuffer.h"
+#include <vector>
+
+#define RATE        16000
+#define READ_BYTES  1024        // 录音任务一次读 512 帧单声道
+
+static std::vector<uint8_t> pattern(size_t n) {
+    std::vector<uint8_t> v(n);
+    for (size_t i = 0; i < n; i++) v[i] = (uint8_t)(testRand() >> 11);
+    return v;
+}
+
+// 像录音任务那样按段内剩余空间写：一次最多 READ_BYTES，跨段时少写一些
+static bool record(RecordBuffer &buf, uint32_t offset, const uint8_t *src, uint32_t len) {
+    while (len > 0) {
+        uint32_t room;
+        uint8_t *dst = buf.writePtr(offset, &room);
+        if (dst == NULL) return false;
+        uint32_t n = len < room ? len : room;
+        if (n > READ_BYTES) n = READ_BYTES;
+        memcpy(dst, src, n);
+        offset += n;
+        src += n;
+        len -= n;
+    }
+    return true;
+}
+
+// 用分散 / 聚集列表读出 [offset, offset + len)，与 expect 逐字节比较
+static bool spansMatch(const RecordBuffer &buf, uint32_t offset, uint32_t len, const uint8_t *expect) {
+    RecSpan spans[8];
+    while (len > 0) {
+        int n = buf.spans(offset, len, spans, 8);
+        if (n == 0) return false;
+        for (int i = 0; i < n; i++) {
+            if (memcmp(spans[i].data, expect, spans[i].len) != 0) return false;
+            expect += spans[i].len;
+            offset += spans[i].len;
+            len -= spans[i].len;
+        }
+    }
+    return true;
+}
+
+static void testLongRecording() {
+    const uint32_t len = 90 * RATE * 2;
+    std::vector<uint8_t> src = pattern(len);
+    RecordBuffer buf;
+    CHECK(record(buf, 0, src.data(), len), "90 s recording failed");
+    uint32_t want = (len + REC_SEGMENT_BYTES - 1) / REC_SEGMENT_BYTES;
+    CHECK(buf.segments() == want && want == 88, "90 s used %u segments, expected %u", buf.segments(), want);
+    CHECK(spansMatch(buf, 0, len, src.data()), "spans differ from the recorded stream");
+    CHECK(spansMatch(buf, 12345, 100000, src.data() + 12345), "spans from an unaligned offset differ");
+    buf.release();
+}
+
+static void testSegmentCap() {
+    RecordBuffer buf;
+    uint32_t room;
+    uint32_t cap = buf.capacity();
+    CHECK(cap == (uint32_t)REC_MAX_SEGMENTS * REC_SEGMENT_BYTES, "capacity %u", cap);
+    CHECK(buf.writePtr(cap - 1, &room) != NULL && room == 1, "last byte below the cap not writable");
+    CHECK(buf.segments() == REC_MAX_SEGMENTS, "%u segments at the cap", buf.segments());
+    CHECK(buf.writePtr(cap, &room) == NULL, "write past %d segments succeeded", REC_MAX_SEGMENTS);
+    uint8_t tail[64] = {};
+    CHECK(!buf.write(cap - 32, tail, sizeof(tail)), "write straddling the cap succeeded");
+    CHECK(buf.segments() == REC_MAX_SEGMENTS, "failed write changed the segment count");
+    buf.release();
+}
+
+static void testPoolReuse() {
+    RecordBuffer first;
+    std::vector<uint8_t> src = pattern(6 * REC_SEGMENT_BYTES);
+    record(first, 0, src.data(), src.size());
+    const uint8_t *segs[6];
+    for (int i = 0; i < 6; i++) {
+        uint32_t n = 1;
+        segs[i] = first.readPtr(i * REC_SEGMENT_BYTES, &n);
+    }
+    first.release();
+    CHECK(first.segments() == 0, "release left %u segments", first.segments());
+    CHECK(RecordBuffer::pooled() == REC_POOL_KEEP, "%u segments pooled, expected %d", RecordBuffer::pooled(), REC_POOL_KEEP);
+
+    // 下一段录音先用池里的段，池空了才向堆申请
+    RecordBuffer next;
+    record(next, 0, src.data(), REC_POOL_KEEP * REC_SEGMENT_BYTES);
+    CHECK(RecordBuffer::pooled() == 0, "%u segments left in the pool", RecordBuffer::pooled());
+    int reused = 0;
+    for (int i = 0; i < REC_POOL_KEEP; i++) {
+        uint32_t n = 1;
+        const uint8_t *p = next.readPtr(i * REC_SEGMENT_BYTES, &n);
+        for (int j = 0; j < 6; j++) reused += (p == segs[j]);
+    }
+    CHECK(reused == REC_POOL_KEEP, "%d of %d pooled segments reused", reused, REC_POOL_KEEP);
+    next.release();
+}
+
+// VAD 裁掉开口前的静音：把最近一段搬回 WAV 头之后，源和目的都跨段
+static void testCopyWithin() {
+    std::vector<uint8_t> src = pattern(3 * REC_SEGMENT_BYTES);
+    RecordBuffer buf;
+    record(buf, 0, src.data(), src.size());
+    const uint32_t from = 2 * REC_SEGMENT_BYTES - 3000, to = REC_SEGMENT_BYTES - 1000, len = 6400;
+    CHECK(buf.copyWithin(to, from, len), "copyWithin failed");
+    CHECK(spansMatch(buf, to, len, src.data() + from), "copyWithin across a segment boundary differs");
+    CHECK(spansMatch(buf, 0, to, src.data()), "copyWithin touched bytes before the destination");
+    buf.release();
+}
+
+// 预录音环形区整段交给录音：绕过一圈的环形区从 pos 开始是最旧的数据
+static void testAdoptLead() {
+    const uint32_t pos = 10000;
+    std::vector<uint8_t> ring = pattern(REC_SEGMENT_BYTES);
+    uint8_t *seg = RecordBuffer::takeSegment();
+    memcpy(seg, ring.data(), REC_SEGMENT_BYTES);
+    std::vector<uint8_t> expect(ring.begin() + pos, ring.end());
+    expect.insert(expect.end(), ring.begin(), ring.begin() + pos);
+
+    RecordBuffer buf;
+    CHECK(buf.adoptLead(seg, pos), "adoptLead on an empty buffer failed");
+    CHECK(!buf.adoptLead(seg, 0), "adoptLead on a non-empty buffer succeeded");
+    CHECK(buf.segments() == 1, "%u segments after adopt", buf.segments());
+    CHECK(spansMatch(buf, 0, REC_SEGMENT_BYTES, expect.data()), "adopted ring not read oldest first");
+
+    // WAV 头写在偏移 0 (覆盖最旧的 44 字节)，录音接着写进第二段
+    uint8_t header[44];
+    memset(header, 0xAB, sizeof(header));
+    memcpy(expect.data(), header, sizeof(header));
+    std::vector<uint8_t> live = pattern(5000);
+    expect.insert(expect.end(), live.begin(), live.end());
+    CHECK(buf.write(0, header, sizeof(header)), "header write failed");
+    CHECK(record(buf, REC_SEGMENT_BYTES, live.data(), live.size()), "write after the adopted ring failed");
+    CHECK(seg[pos] == 0xAB && seg[pos + 43] == 0xAB, "header not at the ring's oldest bytes");
+    CHECK(spansMatch(buf, 0, expect.size(), expect.data()), "stream after adopt differs");
+
+    // 没绕过一圈：头放在段尾，预录音从段首开始，录音接着环形区往后写
+    RecordBuffer part;
+    uint8_t *seg2 = RecordBuffer::takeSegment();
+    memcpy(seg2, ring.data(), pos);
+    CHECK(part.adoptLead(seg2, REC_SEGMENT_BYTES - 44), "adoptLead with a partial ring failed");
+    part.write(0, header, sizeof(header));
+    record(part, 44 + pos, live.data(), live.size());
+    std::vector<uint8_t> want(header, header + 44);
+    want.insert(want.end(), ring.begin(), ring.begin() + pos);
+    want.insert(want.end(), live.begin(), live.end());
+    CHECK(spansMatch(part, 0, want.size(), want.data()), "partial ring stream differs");
+    CHECK(seg2[REC_SEGMENT_BYTES - 44] == 0xAB, "header not in the ring's free tail");
+
+    buf.release();
+    part.release();
+    CHECK(RecordBuffer::pooled() == REC_POOL_KEEP, "%u segments pooled after releasing adopted rings", RecordBuffer::pooled());
+}
+
+int main() {
+    testLongRecording();
+    testSegmentCap();
+    testPoolReuse();
+    testCopyWithin();
+    testAdoptLead();
+    return testResult("recbuffer");
+}
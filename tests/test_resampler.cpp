@@ -0,0 +1,99 @@
+// 回复重采样：常见 TTS 采样率到 16 kHz 的输出长度、1 kHz 单音信噪比、混叠抑制、分片无关性；附每输出采样周期数
+#include "host/host.h"
+#include "App_Resampler.h"
+
+#define OUT_RATE    16000
+
+static int16_t in[48000];
+static int16_t out[OUT_RATE * 2];
+static int16_t ref[OUT_RATE * 2];
+
+// 单频正弦的信噪比：最小二乘拟合同频正弦后算残差
+static double toneSnr(const int16_t *x, int n, double f, int fs) {
+    double ss = 0, sc = 0, cc = 0, xs = 0, xc = 0;
+    for (int i = 0; i < n; i++) {
+        double s = sin(2 * PI * f * i / fs), c = cos(2 * PI * f * i / fs);
+        ss += s * s; cc += c * c; sc += s * c; xs += x[i] * s; xc += x[i] * c;
+    }
+    double det = ss * cc - sc * sc;
+    double a = (xs * cc - xc * sc) / det, b = (xc * ss - xs * sc) / det;
+    double err = 0, pow = 0;
+    for (int i = 0; i < n; i++) {
+        double y = a * sin(2 * PI * f * i / fs) + b * cos(2 * PI * f * i / fs);
+        err += (x[i] - y) * (x[i] - y);
+        pow += y * y;
+    }
+    return 10 * log10(pow / err);
+}
+
+static void sine(int fs, double f) {
+    for (int i = 0; i < fs; i++) in[i] = (int16_t)lrint(16000 * sin(2 * PI * f * i / fs));
+}
+
+static void testRate(int fs) {
+    PolyphaseResampler rs;
+    const int skip = 64;    // 滤波器起始的暂态
+
+    // 1 s 的 1 kHz 单音，按 1..301 的不规则分片喂入 (网络分片大小不定)
+    sine(fs, 1000);
+    rs.begin(fs, OUT_RATE);
+    size_t got = 0;
+    for (int i = 0, k = 0; i < fs; k++) {
+        int c = (k * 37) % 301 + 1;
+        if (c > fs - i) c = fs - i;
+        CHECK(got + rs.maxOutput(c) <= sizeof(out) / 2, "%d Hz: output overflow", fs);
+        got += rs.process(in + i, c, out + got);
+        i += c;
+    }
+    CHECK(abs((int)got - OUT_RATE) <= 1, "%d Hz: %zu output samples for 1 s", fs, got);
+    double snr = toneSnr(out + skip, (int)got - 2 * skip, 1000, OUT_RATE);
+    CHECK(snr > 70, "%d Hz: SNR %.1f dB", fs, snr);
+
+    // 一次性喂入的结果必须完全相同
+    rs.begin(fs, OUT_RATE);
+    size_t whole = rs.process(in, fs, ref);
+    CHECK(whole == got && memcmp(ref, out, got * 2) == 0, "%d Hz: chunked output differs from one-shot", fs);
+
+    // 降采样时，新奈奎斯特频率以上的分量 (fs/2 - 1 kHz) 要被滤掉
+    double alias = 0;
+    if (fs > OUT_RATE) {
+        sine(fs, fs / 2.0 - 1000);
+        rs.begin(fs, OUT_RATE);
+        size_t n = rs.process(in, fs, out);
+        double p = 0;
+        for (size_t i = skip; i < n; i++) p += (double)out[i] * out[i];
+        alias = 10 * log10(p / (n - skip) / (16000.0 * 16000 / 2));
+        CHECK(alias < -60, "%d Hz: alias %.1f dB", fs, alias);
+    }
+
+    rs.begin(fs, OUT_RATE);
+    uint64_t best = ~0ull;
+    size_t n = 0;
+    for (int r = 0; r < 10; r++) {
+        rs.reset();
+        uint64_t c0 = cycleCount();
+        n = rs.process(in, fs, out);
+        uint64_t c = cycleCount() - c0;
+        if (c < best) best = c;
+    }
+    char aliasText[16] = "     -";
+    if (fs > OUT_RATE) snprintf(aliasText, sizeof(aliasText), "%6.1f", alias);
+    printf("%5d Hz: %5zu out/s  SNR %5.1f dB  alias %s dB  %5.1f " CYCLE_UNIT "/out\n",
+           fs, got, snr, aliasText, (double)best / n);
+}
+
+static void testBypass() {
+    PolyphaseResampler rs;
+    rs.begin(OUT_RATE, OUT_RATE);
+    CHECK(rs.isBypass(), "16 kHz -> 16 kHz not bypassed");
+    makeVoice(in, 1000, OUT_RATE, 8000, 100);
+    size_t n = rs.process(in, 1000, out);
+    CHECK(n == 1000 && memcmp(in, out, 2000) == 0, "bypass changed the samples");
+}
+
+int main() {
+    const int rates[] = { 8000, 11025, 22050, 24000, 32000, 44100, 48000 };
+    for (int fs : rates) testRate(fs);
+    testBypass();
+    return testResult("test_resampler");
+}
@@ -0,0 +1,64 @@
+// VAD：开口判决时间、结尾静音计数、纯噪声 / 短促按键声不误判；附每采样周期数
+#include "host/host.h"
+#include "App_Vad.h"
+
+#define RATE    16000
+
+static int16_t clip[RATE * 4];
+
+static void noise(int16_t *out, int n, int amp) {
+    for (int i = 0; i < n; i++) out[i] = (int16_t)((int)(testRand() % (2 * amp + 1)) - amp);
+}
+
+// 1 s 噪声 + 1 s 浊音 + 2 s 噪声，按录音任务的读取粒度 (512) 喂入
+static void testUtterance() {
+    noise(clip, RATE, 60);
+    for (int i = 0; i < RATE; i++) {
+        clip[RATE + i] = (int16_t)(3000 * sin(2 * PI * 220 * i / RATE) + (int)(testRand() % 121) - 60);
+    }
+    noise(clip + 2 * RATE, 2 * RATE, 60);
+
+    VoiceDetector vad;
+    vad.begin(RATE);
+    int onset = -1;
+    for (int i = 0; i < RATE * 4; i += 512) {
+        vad.process(clip + i, 512);
+        if (onset < 0 && vad.speechDetected()) onset = i + 512;
+    }
+    double onsetMs = (onset - RATE) * 1000.0 / RATE;
+    CHECK(onset > RATE && onsetMs <= 100, "onset at %.0f ms after speech start", onsetMs);
+    CHECK(abs((int)vad.silenceMs() - 2000) <= 40, "trailing silence %u ms, expected ~2000", vad.silenceMs());
+    printf("onset %.0f ms after speech, trailing silence %u ms\n", onsetMs, vad.silenceMs());
+}
+
+static void testNoFalseOnset() {
+    VoiceDetector vad;
+    vad.begin(RATE);
+    noise(clip, RATE * 3, 60);
+    // 中间夹一个 10 ms 的按键声，短于确认开口需要的帧数
+    for (int i = 0; i < RATE / 100; i++) clip[RATE + i] = (i & 1) ? 12000 : -12000;
+    for (int i = 0; i < RATE * 3; i += 333) vad.process(clip + i, (RATE * 3 - i < 333) ? RATE * 3 - i : 333);
+    CHECK(!vad.speechDetected(), "noise with a key click detected as speech");
+    CHECK(vad.silenceSamples() == 0, "silence counted before onset");
+}
+
+static void benchmark() {
+    VoiceDetector vad;
+    vad.begin(RATE);
+    uint64_t best = ~0ull;
+    for (int r = 0; r < 30; r++) {
+        vad.reset();
+        uint64_t c0 = cycleCount();
+        for (int i = 0; i < RATE * 4; i += 512) vad.process(clip + i, 512);
+        uint64_t c = cycleCount() - c0;
+        if (c < best) best = c;
+    }
+    printf("VAD %.1f " CYCLE_UNIT "/sample\n", (double)best / (RATE * 4));
+}
+
+int main() {
+    testUtterance();
+    testNoFalseOnset();
+    benchmark();
+    return testResult("test_vad");
+}
@@ -0,0 +1,169 @@
+// 回复 WAV 头解析：任意分片、无关块 / 扩展 fmt、可播放格式判断 (含 WAVE_FORMAT_EXTENSIBLE 子格式)
+#include "host/host.h"
+#include "App_Wav.h"
+#include <vector>
+#include <string>
+
+struct WavBuilder {
+    std::vector<uint8_t> b;
+
+    WavBuilder() { tag("RIFF"); u32(0); tag("WAVE"); }
+    void tag(const char *s) { raw((const uint8_t *)s, 4); }
+    void u16(uint16_t v) { b.push_back(v & 0xFF); b.push_back(v >> 8); }
+    void u32(uint32_t v) { for (int i = 0; i < 4; i++) b.push_back((v >> (8 * i)) & 0xFF); }
+    void raw(const uint8_t *p, size_t n) { for (size_t i = 0; i < n; i++) b.push_back(p[i]); }
+
+    // extra 为 fmt 前 16 字节之后的扩展部分
+    void fmt(uint16_t format, uint16_t ch, uint32_t rate, uint16_t align, uint16_t bits,
+             const std::vector<uint8_t> &extra = std::vector<uint8_t>()) {
+        tag("fmt ");
+        u32(16 + extra.size());
+        u16(format); u16(ch); u32(rate); u32(rate * align); u16(align); u16(bits);
+        raw(extra.data(), extra.size());
+        if (extra.size() & 1) b.push_back(0);
+    }
+    void chunk(const char *id, size_t len) {
+        tag(id);
+        u32(len);
+        for (size_t i = 0; i < len + (len & 1); i++) b.push_back((uint8_t)i);
+    }
+    size_t data(uint32_t len) { tag("data"); u32(len); return b.size(); }
+};
+
+// 扩展 fmt：cbSize = 22，有效位数，声道掩码，子格式 GUID (格式码 + KSDATAFORMAT 公共尾部)
+static std::vector<uint8_t> extensible(uint16_t subFormat, bool standardGuid = true) {
+    static const uint8_t tail[14] = { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+    std::vector<uint8_t> e = { 22, 0, 16, 0, 4, 0, 0, 0 };
+    e.push_back(subFormat & 0xFF);
+    e.push_back(subFormat >> 8);
+    e.insert(e.end(), tail, tail + 14);
+    if (!standardGuid) e.back() ^= 0xFF;
+    return e;
+}
+
+static void parseWhole(WavParser &w, const std::vector<uint8_t> &b) {
+    w.reset();
+    w.feed(b.data(), b.size());
+}
+
+static void testPlainHeader() {
+    WavBuilder wb;
+    wb.fmt(WAV_FORMAT_PCM, 1, 16000, 2, 16);
+    size_t hdr = wb.data(32000);
+    wb.b.push_back(0x55);
+
+    WavParser w;
+    w.reset();
+    size_t used = w.feed(wb.b.data(), wb.b.size());
+    CHECK(w.state() == WAV_READY && used == hdr && hdr == 44, "state %d used %zu hdr %zu", w.state(), used, hdr);
+    CHECK(w.format().sampleRate == 16000 && w.format().dataBytes == 32000, "rate %u data %u",
+          w.format().sampleRate, w.format().dataBytes);
+    CHECK(w.isPlayable(), "16 kHz mono PCM not playable");
+    CHECK(w.feed(wb.b.data() + hdr, 1) == 0, "parser consumed audio after READY");
+}
+
+// LIST + 18 字节 fmt + 奇数长度块 + fact；逐字节喂入和在任意位置切两段的结果都要一致
+static void testSplits() {
+    WavBuilder wb;
+    wb.chunk("LIST", 5);
+    wb.fmt(WAV_FORMAT_PCM, 2, 24000, 4, 16, std::vector<uint8_t>{ 0, 0 });
+    wb.chunk("junk", 3);
+    wb.chunk("fact", 4);
+    size_t hdr = wb.data(4000);
+    wb.b.push_back(0x11);
+
+    WavParser w;
+    w.reset();
+    size_t used = 0;
+    for (size_t i = 0; i < wb.b.size() && w.state() == WAV_NEED_MORE; i++) used += w.feed(&wb.b[i], 1);
+    CHECK(w.state() == WAV_READY && used == hdr && w.headerBytes() == hdr, "byte-wise: state %d used %zu of %zu",
+          w.state(), used, hdr);
+    CHECK(w.format().channels == 2 && w.format().sampleRate == 24000 && w.isPlayable(), "byte-wise format wrong");
+
+    for (size_t cut = 1; cut < wb.b.size(); cut++) {
+        w.reset();
+        size_t n = w.feed(wb.b.data(), cut);
+        if (w.state() == WAV_NEED_MORE) n += w.feed(wb.b.data() + cut, wb.b.size() - cut);
+        if (w.state() != WAV_READY || n != hdr || w.format().sampleRate != 24000) {
+            CHECK(false, "split at %zu: state %d used %zu", cut, w.state(), n);
+            break;
+        }
+    }
+}
+
+static void testRejected() {
+    WavParser w;
+    w.reset();
+    w.feed((const uint8_t *)"ID3\x03garbage!", 12);
+    CHECK(w.state() == WAV_ERROR, "non-RIFF input accepted");
+
+    WavBuilder noFmt;
+    noFmt.data(100);
+    parseWhole(w, noFmt.b);
+    CHECK(w.state() == WAV_ERROR, "data before fmt accepted");
+}
+
+struct FormatCase {
+    const char *name;
+    uint16_t format, channels, align, bits;
+    uint32_t rate;
+    bool playable;
+};
+
+static void testPlayable() {
+    const FormatCase cases[] = {
+        { "pcm8 stereo",      WAV_FORMAT_PCM,       2, 2,   8,  22050, true  },
+        { "pcm24",            WAV_FORMAT_PCM,       1, 3,   24, 16000, false },
+        { "3 channels",       WAV_FORMAT_PCM,       3, 6,   16, 16000, false },
+        { "bad blockAlign",   WAV_FORMAT_PCM,       1, 4,   16, 16000, false },
+        { "rate too low",     WAV_FORMAT_PCM,       1, 2,   16, 2000,  false },
+        { "ima mono",         WAV_FORMAT_IMA_ADPCM, 1, 256, 4,  16000, true  },
+        { "ima stereo",       WAV_FORMAT_IMA_ADPCM, 2, 512, 4,  16000, false },
+        { "float",            3,                    1, 4,   32, 16000, false },
+    };
+    for (const FormatCase &c : cases) {
+        WavBuilder wb;
+        wb.fmt(c.format, c.channels, c.rate, c.align, c.bits);
+        wb.data(0);
+        WavParser w;
+        parseWhole(w, wb.b);
+        CHECK(w.state() == WAV_READY && w.isPlayable() == c.playable, "%s: playable %d", c.name, w.isPlayable());
+    }
+}
+
+static void testExtensible() {
+    struct {
+        const char *name;
+        std::vector<uint8_t> extra;
+        uint16_t format;
+        bool playable;
+    } cases[] = {
+        { "extensible pcm",   extensible(WAV_FORMAT_PCM),        WAV_FORMAT_PCM,        true  },
+        { "extensible float", extensible(3),                     3,                     false },
+        { "vendor guid",      extensible(WAV_FORMAT_PCM, false), WAV_FORMAT_EXTENSIBLE, false },
+        { "no extension",     std::vector<uint8_t>{ 0, 0 },      WAV_FORMAT_EXTENSIBLE, false },
+    };
+    for (auto &c : cases) {
+        WavBuilder wb;
+        wb.fmt(WAV_FORMAT_EXTENSIBLE, 1, 16000, 2, 16, c.extra);
+        wb.chunk("LIST", 7);
+        size_t hdr = wb.data(64);
+
+        WavParser w;
+        w.reset();
+        size_t used = 0;
+        for (size_t i = 0; i < wb.b.size() && w.state() == WAV_NEED_MORE; i++) used += w.feed(&wb.b[i], 1);
+        CHECK(w.state() == WAV_READY && used == hdr, "%s: state %d used %zu of %zu", c.name, w.state(), used, hdr);
+        CHECK(w.format().format == c.format, "%s: format 0x%04x", c.name, w.format().format);
+        CHECK(w.isPlayable() == c.playable, "%s: playable %d", c.name, w.isPlayable());
+    }
+}
+
+int main() {
+    testPlainHeader();
+    testSplits();
+    testRejected();
+    testPlayable();
+    testExtensible();
+    return testResult("test_wav");
+}
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+# 设备控制路由表生成工具：JSON -> /cmd/table.bin (布局与哈希见 App_Command.h)
+#
+#   python3 tools/gen_cmd_table.py tools/cmd_table.json data/cmd/table.bin
+#
+# 输出放到草图目录的 data/cmd/table.bin，用 LittleFS 上传工具写进数据分区，重启后生效。
+# 输入是一个数组，每项：
+#   {"target": "空调", "action": "开", "value": null, "transport": "ir_nec", "code": "0x11111111"}
+# target 必填，action / value 缺省或为 null 表示 CMD_ANY；数值型 value 按十进制文本匹配 (同 dispatchJson)。
+# transport: ir_nec (4 字节) / ir_coolix (3 字节) / rf433 (payload 原样，"code" 为十六进制字节串)
+import json
+import struct
+import sys
+
+CMD_TABLE_MAGIC = 0x54444D43
+CMD_TABLE_VERSION = 1
+CMD_BUCKET_BITS = 5
+CMD_BUCKETS = 1 << CMD_BUCKET_BITS
+CMD_SLOT_BITS = 7
+CMD_SLOTS = 1 << CMD_SLOT_BITS
+CMD_MAX_ENTRIES = 64
+CMD_PAYLOAD_MAX = 16
+CMD_SEED_LIMIT = 256
+
+TRANSPORTS = {'ir_nec': (1, 4), 'ir_coolix': (2, 3), 'rf433': (3, None)}
+
+M32 = 0xFFFFFFFF
+
+
+def fnv(data, h=2166136261):
+    for c in data:
+        h = ((h ^ c) * 16777619) & M32
+    return h
+
+
+def cmd_hash(s):
+    # 同 cmdHash()：空字段为 CMD_ANY (0)，真实字符串永远不为 0
+    if s is None or s == '':
+        return 0
+    if not isinstance(s, str):
+        s = str(s)
+    h = fnv(s.encode('utf-8'))
+    return h if h else 1
+
+
+def rotl(x, r):
+    return ((x << r) | (x >> (32 - r))) & M32
+
+
+def cmd_key(t, a, v):
+    return t ^ rotl(a, 11) ^ rotl(v, 22)
+
+
+def cmd_bucket(key):
+    return ((key * 0x85EBCA6B) & M32) >> (32 - CMD_BUCKET_BITS)
+
+
+def cmd_slot(key, seed):
+    return (((key ^ ((seed * 0x27D4EB2F) & M32)) * 0x9E3779B1) & M32) >> (32 - CMD_SLOT_BITS)
+
+
+def payload(row):
+    kind = row.get('transport')
+    if kind not in TRANSPORTS:
+        sys.exit('unknown transport %r in %r' % (kind, row))
+    transport, n = TRANSPORTS[kind]
+    code = row.get('code')
+    if n is None:
+        data = bytes.fromhex(code.replace(' ', ''))
+    else:
+        data = int(code, 0).to_bytes(n, 'big')
+    if not data or len(data) > CMD_PAYLOAD_MAX:
+        sys.exit('payload must be 1..%d bytes: %r' % (CMD_PAYLOAD_MAX, row))
+    return transport, data
+
+
+def displace(keys):
+    # hash-and-displace：大桶先放，逐桶找一个让本桶所有键都落在空槽上的位移
+    disp = [0] * CMD_BUCKETS
+    groups = {}
+    for k in keys:
+        groups.setdefault(cmd_bucket(k), []).append(k)
+    used = set()
+    for b, ks in sorted(groups.items(), key=lambda g: -len(g[1])):
+        for d in range(CMD_SEED_LIMIT):
+            slots = {cmd_slot(k, d) for k in ks}
+            if len(slots) == len(ks) and not (slots & used):
+                disp[b] = d
+                used |= slots
+                break
+        else:
+            sys.exit('no displacement for bucket %d (%d keys)' % (b, len(ks)))
+    return disp
+
+
+def build(rows):
+    if not rows or len(rows) > CMD_MAX_ENTRIES:
+        sys.exit('table must have 1..%d entries' % CMD_MAX_ENTRIES)
+    entries = b''
+    keys = []
+    for row in rows:
+        t, a, v = (cmd_hash(row.get(f)) for f in ('target', 'action', 'value'))
+        if t == 0:
+            sys.exit('entry without target: %r' % row)
+        key = cmd_key(t, a, v)
+        if key in keys:
+            sys.exit('duplicate route: %r' % row)
+        keys.append(key)
+        transport, data = payload(row)
+        entries += struct.pack('<IIIBBxx', t, a, v, transport, len(data)) + data.ljust(CMD_PAYLOAD_MAX, b'\0')
+    disp = bytes(displace(keys))
+    header = struct.pack('<IBBxxI', CMD_TABLE_MAGIC, CMD_TABLE_VERSION, len(rows), fnv(entries, fnv(disp)))
+    return header + disp + entries
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit('usage: gen_cmd_table.py <table.json> <table.bin>')
+    with open(sys.argv[1], encoding='utf-8') as f:
+        rows = json.load(f)
+    blob = build(rows)
+    with open(sys.argv[2], 'wb') as f:
+        f.write(blob)
+    print('%s: %d entries, %d bytes' % (sys.argv[2], len(rows), len(blob)))
+
+
+if __name__ == '__main__':
+    main()